@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stddef.h>
+#ifndef __cplusplus
+#include <stdbool.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Receive ZIP data produced in streaming mode.
+ *
+ * @param context Context passed by the caller together with the callback.
+ * @param data    Data to write.
+ * @param size    Size of data in bytes.
+ * @return true to continue, false to abort.
+ */
+typedef bool (*ZipSinkCallback)(void *context, const void *data, size_t size);
+
+/**
+ * @brief Receive uncompressed bytes processed so far, and in total if known, 0 otherwise.
+ *
+ * @param context        Context passed by the caller together with the callback.
+ * @param processed_size Bytes processed so far.
+ * @param total_size     Bytes to process in total, 0 if unknown.
+ * @return true to continue, false to abort.
+ */
+typedef bool (*ZipProgressCallback)(void *context, unsigned long long processed_size, unsigned long long total_size);
+
+#ifdef __cplusplus
+}
+#endif
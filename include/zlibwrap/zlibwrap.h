@@ -1,8 +1,16 @@
 #pragma once
 
+#include <ctime>
+#include <string>
+#include <vector>
+#include <zlibwrap/callback.h>
 #ifdef _WIN32
 #include <tchar.h>
 #endif
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#include <string_view>
+#define ZLIBWRAP_HAS_STRING_VIEW
+#endif
 
 namespace zlibwrap {
 
@@ -19,6 +27,28 @@ bool ZipCompress(const TCHAR *zip_file, const TCHAR *pattern);
 bool ZipCompress(const char *zip_file, const char *pattern);
 #endif
 
+/**
+ * @brief Receive ZIP data produced in streaming mode, see ZipSinkCallback.
+ */
+typedef ::ZipSinkCallback ZipSink;
+
+/**
+ * @brief Compress files to a sink in streaming mode, which never seeks, so that pipes and sockets can be written to.
+ *
+ * CRC32 and sizes of each entry follow its data in a data descriptor (general purpose bit 3), and data is passed to
+ * the sink in chunks of bounded size as soon as it is produced.
+ *
+ * @param sink    Callback receiving ZIP data.
+ * @param context Context passed to sink.
+ * @param pattern Source files, supporting wildcards.
+ * @return true/false
+ */
+#ifdef _WIN32
+bool ZipCompress(ZipSink sink, void *context, const TCHAR *pattern);
+#else
+bool ZipCompress(ZipSink sink, void *context, const char *pattern);
+#endif
+
 /**
  * @brief Extract files from a ZIP file.
  *
@@ -32,4 +62,149 @@ bool ZipExtract(const TCHAR *zip_file, const TCHAR *target_dir);
 bool ZipExtract(const char *zip_file, const char *target_dir);
 #endif
 
+/**
+ * @brief Options of extracting a ZIP file, combined with bitwise OR.
+ */
+enum ZipExtractFlags {
+  ZIP_EXTRACT_SKIP_UNCHANGED = 0x1, // Skip entries whose target file has the same size and modification time.
+  ZIP_EXTRACT_COMPARE_CRC = 0x2,    // With ZIP_EXTRACT_SKIP_UNCHANGED, also require CRC32 of the target file to match.
+};
+
+/**
+ * @brief Statistics of extracting a ZIP file.
+ */
+struct ZipExtractStats {
+  unsigned long long extracted_entries;
+  unsigned long long extracted_bytes; // Uncompressed bytes written.
+  unsigned long long skipped_entries;
+  unsigned long long skipped_bytes; // Uncompressed bytes of entries skipped as unchanged.
+};
+
+/**
+ * @brief Extract files from a ZIP file, optionally skipping files already up to date.
+ *
+ * Entries are compared with their target files using sizes and times from the central directory, so unchanged entries
+ * are neither inflated nor written. Modification times match within 2 seconds, the precision of ZIP files.
+ *
+ * @param zip_file   Source ZIP file.
+ * @param target_dir Directory to output files.
+ * @param flags      Combination of ZipExtractFlags.
+ * @param stats      Optional, receives numbers of entries and bytes extracted and skipped.
+ * @return true/false
+ */
+#ifdef _WIN32
+bool ZipExtract(const TCHAR *zip_file, const TCHAR *target_dir, unsigned int flags, ZipExtractStats *stats = NULL);
+#else
+bool ZipExtract(const char *zip_file, const char *target_dir, unsigned int flags, ZipExtractStats *stats = NULL);
+#endif
+
+/**
+ * @brief Provide ZIP data consumed in streaming mode.
+ *
+ * @param context Context passed by the caller together with the source.
+ * @param buffer  Buffer to fill.
+ * @param size    Size of buffer in bytes on input, number of bytes filled on output, 0 at the end of data.
+ * @return true to continue, false to abort.
+ */
+typedef bool (*ZipSource)(void *context, void *buffer, size_t *size);
+
+/**
+ * @brief Extract files from a source in streaming mode, which reads forward only, so that pipes and sockets can be
+ * read from while data is still arriving.
+ *
+ * Entries are extracted in the order of their local headers. Reading stops at the central directory, unless it is
+ * requested to be verified against the entries extracted.
+ *
+ * @param source                   Callback providing ZIP data.
+ * @param context                  Context passed to source.
+ * @param target_dir               Directory to output files.
+ * @param verify_central_directory Whether to read the central directory and check it against the entries extracted.
+ * @return true/false
+ */
+#ifdef _WIN32
+bool ZipExtract(ZipSource source, void *context, const TCHAR *target_dir, bool verify_central_directory = false);
+#else
+bool ZipExtract(ZipSource source, void *context, const char *target_dir, bool verify_central_directory = false);
+#endif
+
+/**
+ * @brief Reasons of an entry failing the integrity test.
+ */
+enum ZipTestError {
+  ZIP_TEST_BAD_HEADER,    // Entry can not be located, or its local header does not match the central directory.
+  ZIP_TEST_BAD_DATA,      // Compressed data is corrupted.
+  ZIP_TEST_CRC_MISMATCH,  // CRC32 of extracted data does not match the central directory.
+  ZIP_TEST_SIZE_MISMATCH, // Size of extracted data does not match the central directory.
+};
+
+/**
+ * @brief An entry failing the integrity test.
+ */
+struct ZipTestFailure {
+  std::string inner_path; // Entry path as stored in the ZIP file.
+  ZipTestError error;
+};
+
+/**
+ * @brief Test integrity of a ZIP file by extracting all entries in memory, without writing anything to disk.
+ *
+ * If the ZIP file can not be opened or enumerated, false is returned with no failures.
+ *
+ * @param zip_file     Source ZIP file.
+ * @param failures     Optional, receives entries failing the test, in the order of the central directory.
+ * @param thread_count Number of threads to extract entries in parallel, 0 to use the number of CPU cores.
+ * @return true/false
+ */
+#ifdef _WIN32
+bool ZipTest(const TCHAR *zip_file, std::vector<ZipTestFailure> *failures = NULL, unsigned int thread_count = 0);
+#else
+bool ZipTest(const char *zip_file, std::vector<ZipTestFailure> *failures = NULL, unsigned int thread_count = 0);
+#endif
+
+/**
+ * @brief An entry read from the central directory.
+ */
+struct ZipEntryInfo {
+  const char *inner_path;  // Entry path as stored in the ZIP file, not null-terminated.
+  size_t inner_path_size;  // Size of inner_path in bytes.
+  unsigned long long compressed_size;
+  unsigned long long uncompressed_size;
+  unsigned long crc;
+  unsigned int compression_method;
+  unsigned int flag;       // General purpose bit flag, with 0x800 set if inner_path is UTF-8.
+  unsigned long dos_date;  // Last modification date and time in MS-DOS format.
+  tm modified_time;        // Last modification date and time in local time, decoded from dos_date.
+
+#ifdef ZLIBWRAP_HAS_STRING_VIEW
+  std::string_view InnerPath() const {
+    return std::string_view(inner_path, inner_path_size);
+  }
+#endif
+};
+
+/**
+ * @brief Receive an entry listed. Pointers in entry are valid only until the callback returns.
+ *
+ * @param context Context passed by the caller together with the callback.
+ * @param entry   Entry listed.
+ * @return true to continue, false to abort.
+ */
+typedef bool (*ZipListCallback)(void *context, const ZipEntryInfo &entry);
+
+/**
+ * @brief List entries of a ZIP file in the order of the central directory.
+ *
+ * The central directory is read at once and entries are parsed in place, so no memory is allocated per entry.
+ *
+ * @param zip_file Source ZIP file.
+ * @param callback Callback receiving entries.
+ * @param context  Context passed to callback.
+ * @return true if all entries were listed.
+ */
+#ifdef _WIN32
+bool ZipList(const TCHAR *zip_file, ZipListCallback callback, void *context);
+#else
+bool ZipList(const char *zip_file, ZipListCallback callback, void *context);
+#endif
+
 } // namespace zlibwrap
@@ -16,9 +16,14 @@
 #endif
 // clang-format on
 
+#include <stddef.h>
+#ifndef __cplusplus
+#include <stdbool.h>
+#endif
 #ifdef _WIN32
 #include <tchar.h>
 #endif
+#include <zlibwrap/callback.h>
 
 /**
  * @brief Compress files to a ZIP file.
@@ -45,3 +50,213 @@ ZLIBWRAP_API bool ZipExtract(const TCHAR *zip_file, const TCHAR *target_dir);
 #else
 ZLIBWRAP_API bool ZipExtract(const char *zip_file, const char *target_dir);
 #endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ZipWriterObject *ZipWriterHandle;
+typedef struct ZipReaderObject *ZipReaderHandle;
+
+/**
+ * @brief Create a ZIP file for writing.
+ *
+ * @param zip_file Target ZIP file path.
+ * @return Handle to close with ZipWriterClose, NULL on failure.
+ */
+#ifdef _WIN32
+ZLIBWRAP_API ZipWriterHandle ZipWriterOpen(const TCHAR *zip_file);
+#else
+ZLIBWRAP_API ZipWriterHandle ZipWriterOpen(const char *zip_file);
+#endif
+
+/**
+ * @brief Write a ZIP file to a callback in a single forward pass.
+ *
+ * @param callback Receives ZIP data.
+ * @param context  Context passed to callback.
+ * @return Handle to close with ZipWriterClose, NULL on failure.
+ */
+ZLIBWRAP_API ZipWriterHandle ZipWriterOpenCallback(ZipSinkCallback callback, void *context);
+
+/**
+ * @brief Set compression level of entries added afterwards, 9 by default.
+ *
+ * @param writer Writer handle.
+ * @param level  Compression level, from 0 (no compression) to 9 (best compression).
+ * @return true/false
+ */
+ZLIBWRAP_API bool ZipWriterSetLevel(ZipWriterHandle writer, int level);
+
+/**
+ * @brief Set callback receiving uncompressed bytes added. Total size is always 0.
+ *
+ * @param writer   Writer handle.
+ * @param callback Progress callback, NULL to disable.
+ * @param context  Context passed to callback.
+ * @return true/false
+ */
+ZLIBWRAP_API bool ZipWriterSetProgressCallback(ZipWriterHandle writer, ZipProgressCallback callback, void *context);
+
+/**
+ * @brief Add files to the ZIP file.
+ *
+ * @param writer  Writer handle.
+ * @param pattern Source files, supporting wildcards.
+ * @return true/false
+ */
+#ifdef _WIN32
+ZLIBWRAP_API bool ZipWriterAddFiles(ZipWriterHandle writer, const TCHAR *pattern);
+#else
+ZLIBWRAP_API bool ZipWriterAddFiles(ZipWriterHandle writer, const char *pattern);
+#endif
+
+/**
+ * @brief Add an entry from memory, timed now.
+ *
+ * @param writer     Writer handle.
+ * @param inner_path Entry path in UTF-8, ending with '/' for directories.
+ * @param data       Entry data, ignored for directories.
+ * @param size       Size of data in bytes.
+ * @return true/false
+ */
+ZLIBWRAP_API bool ZipWriterAddMemory(ZipWriterHandle writer, const char *inner_path, const void *data, size_t size);
+
+/**
+ * @brief Finish the ZIP file and free the handle.
+ *
+ * @param writer Writer handle.
+ * @return true if all entries and the central directory were written successfully.
+ */
+ZLIBWRAP_API bool ZipWriterClose(ZipWriterHandle writer);
+
+/**
+ * @brief Open a ZIP file for reading.
+ *
+ * @param zip_file Source ZIP file.
+ * @return Handle to close with ZipReaderClose, NULL on failure.
+ */
+#ifdef _WIN32
+ZLIBWRAP_API ZipReaderHandle ZipReaderOpen(const TCHAR *zip_file);
+#else
+ZLIBWRAP_API ZipReaderHandle ZipReaderOpen(const char *zip_file);
+#endif
+
+/**
+ * @brief Open a ZIP file in memory for reading, without copying it.
+ *
+ * @param data ZIP data, which must stay valid until the handle is closed.
+ * @param size Size of data in bytes.
+ * @return Handle to close with ZipReaderClose, NULL on failure.
+ */
+ZLIBWRAP_API ZipReaderHandle ZipReaderOpenMemory(const void *data, size_t size);
+
+/**
+ * @brief Set number of threads used by ZipReaderTest.
+ *
+ * @param reader       Reader handle.
+ * @param thread_count Number of threads, 0 to use the number of CPU cores, which is the default.
+ * @return true/false
+ */
+ZLIBWRAP_API bool ZipReaderSetThreadCount(ZipReaderHandle reader, unsigned int thread_count);
+
+/**
+ * @brief Set callback receiving uncompressed bytes extracted or tested.
+ *
+ * @param reader   Reader handle.
+ * @param callback Progress callback, NULL to disable.
+ * @param context  Context passed to callback.
+ * @return true/false
+ */
+ZLIBWRAP_API bool ZipReaderSetProgressCallback(ZipReaderHandle reader, ZipProgressCallback callback, void *context);
+
+/**
+ * @brief Get number of entries in the ZIP file.
+ *
+ * @param reader Reader handle.
+ * @param count  Receives number of entries.
+ * @return true/false
+ */
+ZLIBWRAP_API bool ZipReaderGetEntryCount(ZipReaderHandle reader, unsigned long long *count);
+
+/**
+ * @brief Get uncompressed size of an entry.
+ *
+ * @param reader     Reader handle.
+ * @param inner_path Entry path as stored in the ZIP file.
+ * @param size       Receives size in bytes.
+ * @return true/false
+ */
+ZLIBWRAP_API bool ZipReaderGetEntrySize(ZipReaderHandle reader, const char *inner_path, unsigned long long *size);
+
+/**
+ * @brief Extract an entry to a caller buffer, checking its CRC32.
+ *
+ * @param reader      Reader handle.
+ * @param inner_path  Entry path as stored in the ZIP file.
+ * @param buffer      Buffer to receive data.
+ * @param buffer_size Size of buffer in bytes.
+ * @param size        Receives size of the entry, also when the buffer is too small.
+ * @return true/false
+ */
+ZLIBWRAP_API bool ZipReaderExtractToBuffer(ZipReaderHandle reader,
+                                           const char *inner_path,
+                                           void *buffer,
+                                           size_t buffer_size,
+                                           size_t *size);
+
+/**
+ * @brief Extract all entries to a directory.
+ *
+ * @param reader     Reader handle.
+ * @param target_dir Directory to output files.
+ * @return true/false
+ */
+#ifdef _WIN32
+ZLIBWRAP_API bool ZipReaderExtract(ZipReaderHandle reader, const TCHAR *target_dir);
+#else
+ZLIBWRAP_API bool ZipReaderExtract(ZipReaderHandle reader, const char *target_dir);
+#endif
+
+/**
+ * @brief Extract all entries to a directory, skipping files with the same size and modification time.
+ *
+ * @param reader          Reader handle.
+ * @param target_dir      Directory to output files.
+ * @param compare_crc     Whether to also require CRC32 of skipped files to match.
+ * @param skipped_entries Optional, receives number of entries skipped.
+ * @param skipped_bytes   Optional, receives uncompressed bytes of entries skipped.
+ * @return true/false
+ */
+#ifdef _WIN32
+ZLIBWRAP_API bool ZipReaderUpdate(ZipReaderHandle reader,
+                                  const TCHAR *target_dir,
+                                  bool compare_crc,
+                                  unsigned long long *skipped_entries,
+                                  unsigned long long *skipped_bytes);
+#else
+ZLIBWRAP_API bool ZipReaderUpdate(ZipReaderHandle reader,
+                                  const char *target_dir,
+                                  bool compare_crc,
+                                  unsigned long long *skipped_entries,
+                                  unsigned long long *skipped_bytes);
+#endif
+
+/**
+ * @brief Test integrity of all entries in parallel, without writing to disk.
+ *
+ * @param reader Reader handle.
+ * @return true if all entries are intact.
+ */
+ZLIBWRAP_API bool ZipReaderTest(ZipReaderHandle reader);
+
+/**
+ * @brief Close the ZIP file and free the handle.
+ *
+ * @param reader Reader handle.
+ */
+ZLIBWRAP_API void ZipReaderClose(ZipReaderHandle reader);
+
+#ifdef __cplusplus
+}
+#endif
@@ -6,6 +6,10 @@ import sys
 import shutil
 import locale
 import codecs
+import ctypes
+import io
+import struct
+import zipfile
 
 
 def write_file(path, content):
@@ -86,6 +90,251 @@ def test_non_ascii_file_name(zip_cmd, unzip_cmd):
     check_file('test_root/解压/目录1/目录2/目录3/文件3', u'内容3')
 
 
+def test_integrity(zip_cmd, unzip_cmd):
+    write_file('test_root/f1', 'content' * 100)
+    os.system('%s test_root/test.zip test_root/f1' % zip_cmd)
+    assert os.system('%s -t test_root/test.zip' % unzip_cmd) == 0, 'Test of intact ZIP file failed'
+    with open('test_root/test.zip', 'rb') as f:
+        data = bytearray(f.read())
+    # compressed data of "f1" follows the 30 bytes local header and the file name
+    data[30 + 2 + 4] ^= 0xff
+    with open('test_root/test.zip', 'wb') as f:
+        f.write(data)
+    assert os.system('%s -t test_root/test.zip > test_root/test.txt' % unzip_cmd) != 0, \
+        'Test of corrupted ZIP file succeeded'
+    with open('test_root/test.txt') as f:
+        output = f.read()
+    assert 'f1: bad data' in output or 'f1: crc mismatch' in output, 'Failure of f1 not reported: %s' % output
+
+    # only the second entry is corrupted, so failures must not be reported under the name of the first
+    with zipfile.ZipFile('test_root/test2.zip', 'w', zipfile.ZIP_STORED) as z:
+        z.writestr('f1', 'content1')
+        z.writestr('f2', 'content2')
+    with open('test_root/test2.zip', 'rb') as f:
+        data = bytearray(f.read())
+    # stored data of "f2" follows the local header and data of "f1", then its own local header and file name
+    data[(30 + 2 + 8) + 30 + 2] ^= 0xff
+    with open('test_root/test2.zip', 'wb') as f:
+        f.write(data)
+    assert os.system('%s -t test_root/test2.zip > test_root/test2.txt' % unzip_cmd) != 0, \
+        'Test of corrupted ZIP file succeeded'
+    with open('test_root/test2.txt') as f:
+        output = f.read()
+    assert 'f2: crc mismatch' in output, 'Failure of f2 not reported: %s' % output
+    assert 'f1: ' not in output, 'Intact f1 reported as failed: %s' % output
+
+
+def test_streaming_compress(zip_cmd, unzip_cmd):
+    os.makedirs('test_root/d1/d2')
+    write_file('test_root/d1/f1', 'content1')
+    write_file('test_root/d1/d2/f2', 'content2' * 1000)
+    os.system('%s - test_root/d1 > test_root/test.zip' % zip_cmd)
+    assert os.system('%s -t test_root/test.zip' % unzip_cmd) == 0, 'Test of streamed ZIP file failed'
+    os.system('%s test_root/test.zip test_root/unzip' % unzip_cmd)
+    check_file('test_root/unzip/d1/f1', 'content1')
+    check_file('test_root/unzip/d1/d2/f2', 'content2' * 1000)
+
+
+def test_streaming_zip64_descriptor(zip_cmd, unzip_cmd):
+    os.makedirs('test_root/d1')
+    write_file('test_root/d1/f1', 'content1' * 100)
+    os.system('%s - test_root/d1 > test_root/test.zip' % zip_cmd)
+    with open('test_root/test.zip', 'rb') as f:
+        data = f.read()
+    for info in zipfile.ZipFile('test_root/test.zip').infolist():
+        if info.filename.endswith('/'):
+            continue
+        offset = info.header_offset
+        (signature, version, flag, name_length, extra_length) = struct.unpack('<IHH18xHH', data[offset:offset + 30])
+        assert signature == 0x04034b50 and flag & 0x8, 'Streamed entry has no data descriptor'
+        assert version >= 45, 'Version needed to extract is %d' % version
+        extra = data[offset + 30 + name_length:offset + 30 + name_length + extra_length]
+        assert extra[:4] == struct.pack('<HH', 0x0001, 16), 'Local header has no ZIP64 extra field'
+        descriptor_offset = offset + 30 + name_length + extra_length + info.compress_size
+        # signature, CRC32, then 8-byte compressed and uncompressed sizes
+        descriptor = struct.unpack('<IIQQ', data[descriptor_offset:descriptor_offset + 24])
+        assert descriptor == (0x08074b50, info.CRC, info.compress_size, info.file_size), \
+            'Data descriptor mismatched: %s' % (descriptor,)
+
+
+def test_streaming_extract(zip_cmd, unzip_cmd):
+    os.makedirs('test_root/d1/d2')
+    write_file('test_root/d1/f1', 'content1')
+    write_file('test_root/d1/d2/f2', 'content2' * 1000)
+    os.system('%s - test_root/d1 | %s - test_root/unzip1' % (zip_cmd, unzip_cmd))
+    check_file('test_root/unzip1/d1/f1', 'content1')
+    check_file('test_root/unzip1/d1/d2/f2', 'content2' * 1000)
+    os.system('%s test_root/test.zip test_root/d1' % zip_cmd)
+    os.system('%s - test_root/unzip2 < test_root/test.zip' % unzip_cmd)
+    check_file('test_root/unzip2/d1/f1', 'content1')
+    check_file('test_root/unzip2/d1/d2/f2', 'content2' * 1000)
+
+
+def test_list(zip_cmd, unzip_cmd):
+    os.makedirs('test_root/d1/d2')
+    write_file('test_root/d1/f1', 'content1')
+    write_file('test_root/d1/d2/f2', 'content2' * 1000)
+    os.system('%s test_root/test.zip test_root/d1' % zip_cmd)
+    assert os.system('%s -l test_root/test.zip > test_root/list.txt' % unzip_cmd) == 0, 'List of ZIP file failed'
+    with open('test_root/list.txt') as f:
+        entries = [line.split()[0] + ' ' + line.split()[-1] for line in f.read().splitlines()]
+    expected = ['0 d1/', '0 d1/d2/', '8000 d1/d2/f2', '8 d1/f1']
+    assert sorted(entries) == sorted(expected), 'List of ZIP file mismatched: %s' % entries
+
+
+def test_incremental_extract(zip_cmd, unzip_cmd):
+    os.makedirs('test_root/d1')
+    write_file('test_root/d1/f1', 'content1')
+    write_file('test_root/d1/f2', 'content2')
+    os.system('%s test_root/test.zip test_root/d1' % zip_cmd)
+    os.system('%s test_root/test.zip test_root/unzip' % unzip_cmd)
+    # same size and time, different content, only found by CRC32
+    stat = os.stat('test_root/unzip/d1/f1')
+    write_file('test_root/unzip/d1/f1', 'CONTENT1')
+    os.utime('test_root/unzip/d1/f1', (stat.st_atime, stat.st_mtime))
+    assert os.system('%s -u test_root/test.zip test_root/unzip > test_root/update.txt' % unzip_cmd) == 0, \
+        'Incremental extraction failed'
+    with open('test_root/update.txt') as f:
+        output = f.read()
+    assert 'skipped 1 unchanged entries (8 bytes)' in output, 'Unchanged file not skipped: %s' % output
+    check_file('test_root/unzip/d1/f1', 'content1')
+    check_file('test_root/unzip/d1/f2', 'content2')
+
+
+def check_unsafe_path_extraction(extract_cmd):
+    for (i, unsafe_path) in enumerate(('../evil', 'd1/../../evil', '/tmp/zlibwrap_evil', 'C:evil', '..\\evil')):
+        os.makedirs('test_root/unzip%d/d1' % i)
+        with zipfile.ZipFile('test_root/test%d.zip' % i, 'w', zipfile.ZIP_DEFLATED) as z:
+            z.writestr('safe', 'content1')
+            z.writestr(zipfile.ZipInfo(unsafe_path), 'content2')
+        assert os.system(extract_cmd % {'zip': 'test_root/test%d.zip' % i, 'dir': 'test_root/unzip%d/d1' % i}) != 0, \
+            'Extraction of unsafe path "%s" succeeded' % unsafe_path
+        assert not os.path.exists('test_root/unzip%d/evil' % i), 'File written outside target directory'
+        assert not os.path.exists('test_root/evil'), 'File written outside target directory'
+        assert not os.path.exists('/tmp/zlibwrap_evil'), 'File written to absolute path'
+        check_file('test_root/unzip%d/d1/safe' % i, 'content1')
+
+
+def test_extract_unsafe_path(zip_cmd, unzip_cmd):
+    check_unsafe_path_extraction(unzip_cmd + ' %(zip)s %(dir)s')
+
+
+def test_streaming_extract_unsafe_path(zip_cmd, unzip_cmd):
+    check_unsafe_path_extraction(unzip_cmd + ' - %(dir)s < %(zip)s')
+
+
+def load_zlibwrapd():
+    for name in ('zlibwrapd.dll', 'libzlibwrapd.so', 'libzlibwrapd.dylib'):
+        if os.path.exists(name):
+            lib = ctypes.CDLL(os.path.abspath(name))
+            break
+    else:
+        assert False, 'zlibwrapd not found'
+    handle = ctypes.c_void_p
+    for (function, restype, argtypes) in (
+        ('ZipWriterOpenCallback', handle, [SINK_CALLBACK, ctypes.c_void_p]),
+        ('ZipWriterSetLevel', ctypes.c_bool, [handle, ctypes.c_int]),
+        ('ZipWriterSetProgressCallback', ctypes.c_bool, [handle, PROGRESS_CALLBACK, ctypes.c_void_p]),
+        ('ZipWriterAddMemory', ctypes.c_bool, [handle, ctypes.c_char_p, ctypes.c_void_p, ctypes.c_size_t]),
+        ('ZipWriterClose', ctypes.c_bool, [handle]),
+        ('ZipReaderOpenMemory', handle, [ctypes.c_void_p, ctypes.c_size_t]),
+        ('ZipReaderSetThreadCount', ctypes.c_bool, [handle, ctypes.c_uint]),
+        ('ZipReaderSetProgressCallback', ctypes.c_bool, [handle, PROGRESS_CALLBACK, ctypes.c_void_p]),
+        ('ZipReaderGetEntryCount', ctypes.c_bool, [handle, ctypes.POINTER(ctypes.c_ulonglong)]),
+        ('ZipReaderGetEntrySize', ctypes.c_bool, [handle, ctypes.c_char_p, ctypes.POINTER(ctypes.c_ulonglong)]),
+        ('ZipReaderExtractToBuffer', ctypes.c_bool,
+         [handle, ctypes.c_char_p, ctypes.c_void_p, ctypes.c_size_t, ctypes.POINTER(ctypes.c_size_t)]),
+        ('ZipReaderTest', ctypes.c_bool, [handle]),
+        ('ZipReaderClose', None, [handle]),
+    ):
+        getattr(lib, function).restype = restype
+        getattr(lib, function).argtypes = argtypes
+    return lib
+
+
+SINK_CALLBACK = ctypes.CFUNCTYPE(ctypes.c_bool, ctypes.c_void_p, ctypes.c_void_p, ctypes.c_size_t)
+PROGRESS_CALLBACK = ctypes.CFUNCTYPE(ctypes.c_bool, ctypes.c_void_p, ctypes.c_ulonglong, ctypes.c_ulonglong)
+
+
+def write_zip_in_memory(lib, entries, level=9, progress=None):
+    chunks = []
+    sink = SINK_CALLBACK(lambda context, data, size: chunks.append(ctypes.string_at(data, size)) or True)
+    writer = lib.ZipWriterOpenCallback(sink, None)
+    assert writer, 'Open of writer failed'
+    assert lib.ZipWriterSetLevel(writer, level), 'Set of compression level failed'
+    if progress is not None:
+        lib.ZipWriterSetProgressCallback(writer, progress, None)
+    added = all(lib.ZipWriterAddMemory(writer, name, content, len(content)) for (name, content) in entries)
+    closed = lib.ZipWriterClose(writer)
+    assert added or not closed, 'Close of writer succeeded after a failed entry'
+    return b''.join(chunks) if added and closed else None
+
+
+def read_entry_in_memory(lib, reader, name):
+    size = ctypes.c_size_t()
+    assert not lib.ZipReaderExtractToBuffer(reader, name, None, 0, ctypes.byref(size)), 'Empty buffer accepted'
+    buffer = ctypes.create_string_buffer(size.value)
+    if not lib.ZipReaderExtractToBuffer(reader, name, buffer, size.value, ctypes.byref(size)):
+        return None
+    return buffer.raw[:size.value]
+
+
+def test_handle_api(zip_cmd, unzip_cmd):
+    lib = load_zlibwrapd()
+    entries = [(b'd1/', b''), (b'd1/f1', b'content1' * 1000), (b'd1/f2', b'')]
+    # callbacks must outlive the handles they are passed to
+    null_sink = SINK_CALLBACK(lambda context, data, size: True)
+    writer = lib.ZipWriterOpenCallback(null_sink, None)
+    assert not lib.ZipWriterSetLevel(writer, 10), 'Invalid compression level accepted'
+    lib.ZipWriterClose(writer)
+
+    progress_sizes = []
+    progress = PROGRESS_CALLBACK(lambda context, processed, total: progress_sizes.append(processed) or True)
+    data = write_zip_in_memory(lib, entries, 1, progress)
+    assert data is not None, 'Write of ZIP file in memory failed'
+    assert progress_sizes[-1] == 8000, 'Progress of writer mismatched: %s' % progress_sizes
+    with zipfile.ZipFile(io.BytesIO(data)) as z:
+        assert z.testzip() is None, 'ZIP file written in memory is corrupted'
+        assert [(info.filename.encode(), z.read(info)) for info in z.infolist()] == entries, 'Entries mismatched'
+    aborted = PROGRESS_CALLBACK(lambda context, processed, total: False)
+    assert write_zip_in_memory(lib, entries, 9, aborted) is None, 'Abort of writer by progress callback failed'
+
+    buffer = ctypes.create_string_buffer(data, len(data))
+    reader = lib.ZipReaderOpenMemory(buffer, len(data))
+    assert reader, 'Open of ZIP file in memory failed'
+    count = ctypes.c_ulonglong()
+    assert lib.ZipReaderGetEntryCount(reader, ctypes.byref(count)) and count.value == 3, 'Entry count mismatched'
+    size = ctypes.c_ulonglong()
+    assert lib.ZipReaderGetEntrySize(reader, b'd1/f1', ctypes.byref(size)) and size.value == 8000, 'Size mismatched'
+    assert not lib.ZipReaderGetEntrySize(reader, b'd1/f3', ctypes.byref(size)), 'Missing entry found'
+    small_size = ctypes.c_size_t()
+    small_buffer = ctypes.create_string_buffer(10)
+    assert not lib.ZipReaderExtractToBuffer(reader, b'd1/f1', small_buffer, 10, ctypes.byref(small_size)), \
+        'Extraction to too small buffer succeeded'
+    assert small_size.value == 8000, 'Required buffer size mismatched: %d' % small_size.value
+    assert read_entry_in_memory(lib, reader, b'd1/f1') == b'content1' * 1000, 'Extraction to buffer mismatched'
+    assert lib.ZipReaderSetThreadCount(reader, 2) and lib.ZipReaderTest(reader), 'Test of ZIP file in memory failed'
+    lib.ZipReaderSetProgressCallback(reader, aborted, None)
+    assert read_entry_in_memory(lib, reader, b'd1/f1') is None, 'Abort of reader by progress callback failed'
+    assert not lib.ZipReaderTest(reader), 'Abort of test by progress callback failed'
+    lib.ZipReaderClose(reader)
+
+    # a stored entry with a flipped byte, detected only by CRC32
+    corrupted = io.BytesIO()
+    with zipfile.ZipFile(corrupted, 'w', zipfile.ZIP_STORED) as z:
+        z.writestr('f1', 'content1')
+    data = bytearray(corrupted.getvalue())
+    data[30 + 2] ^= 0xff
+    buffer = ctypes.create_string_buffer(bytes(data), len(data))
+    reader = lib.ZipReaderOpenMemory(buffer, len(data))
+    assert reader, 'Open of corrupted ZIP file in memory failed'
+    assert read_entry_in_memory(lib, reader, b'f1') is None, 'CRC32 mismatch not detected by extraction'
+    assert not lib.ZipReaderTest(reader), 'CRC32 mismatch not detected by test'
+    lib.ZipReaderClose(reader)
+
+    assert not lib.ZipReaderOpenMemory(b'not a zip file', 14), 'Open of invalid ZIP file succeeded'
+
+
 def run_tests():
     if sys.platform == 'win32':
         zip_cmd = 'zip.exe'
@@ -101,6 +350,15 @@ def run_tests():
         test_wildcard1,
         test_wildcard2,
         test_non_ascii_file_name,
+        test_integrity,
+        test_streaming_compress,
+        test_streaming_zip64_descriptor,
+        test_streaming_extract,
+        test_extract_unsafe_path,
+        test_streaming_extract_unsafe_path,
+        test_list,
+        test_incremental_extract,
+        test_handle_api,
     ):
         if os.path.exists('test_root'):
             shutil.rmtree('test_root')
@@ -1,7 +1,12 @@
 #include <cstring>
 #include <locale.h>
 #include <stdio.h>
+#include <vector>
 #include <zlibwrap/zlibwrap.h>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
 
 #ifndef _WIN32
 #define _T(s) s
@@ -9,19 +14,101 @@
 #define _tmain main
 #define _tsetlocale setlocale
 #define _tprintf printf
+#define _tcscmp strcmp
 #endif
 
 void ShowHelp() {
   _tprintf(_T("Usage: unzip <zip_file> <target_dir>\n"));
+  _tprintf(_T("       unzip - <target_dir>    (read from stdin)\n"));
+  _tprintf(_T("       unzip -t <zip_file>\n"));
+  _tprintf(_T("       unzip -l <zip_file>\n"));
+  _tprintf(_T("       unzip -u <zip_file> <target_dir>    (skip unchanged files)\n"));
+}
+
+bool ReadFromStdin(void *context, void *buffer, size_t *size) {
+  *size = fread(buffer, 1, *size, stdin);
+  return ferror(stdin) == 0;
+}
+
+int ExtractFromStdin(const TCHAR *target_dir) {
+#ifdef _WIN32
+  _setmode(_fileno(stdin), _O_BINARY);
+#endif
+
+  if (!zlibwrap::ZipExtract(ReadFromStdin, NULL, target_dir, true)) {
+    _tprintf(_T("Failed to Extract stdin to %s.\n"), target_dir);
+    return -1;
+  }
+
+  _tprintf(_T("Extracted stdin to %s successfully.\n"), target_dir);
+
+  return 0;
+}
+
+int TestZipFile(const TCHAR *zip_file) {
+  std::vector<zlibwrap::ZipTestFailure> failures;
+  if (!zlibwrap::ZipTest(zip_file, &failures)) {
+    const char *errors[] = {"bad header", "bad data", "crc mismatch", "size mismatch"};
+    for (size_t i = 0; i < failures.size(); ++i)
+      printf("%s: %s\n", failures[i].inner_path.c_str(), errors[failures[i].error]);
+    _tprintf(_T("Failed to test %s.\n"), zip_file);
+    return -1;
+  }
+
+  _tprintf(_T("Tested %s successfully.\n"), zip_file);
+
+  return 0;
+}
+
+bool PrintEntry(void *context, const zlibwrap::ZipEntryInfo &entry) {
+  const tm &date = entry.modified_time;
+  printf("%12llu  %04d-%02d-%02d %02d:%02d  %.*s\n", entry.uncompressed_size, date.tm_year + 1900, date.tm_mon + 1,
+         date.tm_mday, date.tm_hour, date.tm_min, (int)entry.inner_path_size, entry.inner_path);
+  return true;
+}
+
+int ListZipFile(const TCHAR *zip_file) {
+  if (!zlibwrap::ZipList(zip_file, PrintEntry, NULL)) {
+    _tprintf(_T("Failed to list %s.\n"), zip_file);
+    return -1;
+  }
+
+  return 0;
+}
+
+int UpdateFromZipFile(const TCHAR *zip_file, const TCHAR *target_dir) {
+  zlibwrap::ZipExtractStats stats = {};
+  if (!zlibwrap::ZipExtract(zip_file, target_dir,
+                            zlibwrap::ZIP_EXTRACT_SKIP_UNCHANGED | zlibwrap::ZIP_EXTRACT_COMPARE_CRC, &stats)) {
+    _tprintf(_T("Failed to Extract %s to %s.\n"), zip_file, target_dir);
+    return -1;
+  }
+
+  printf("Extracted %llu entries (%llu bytes), skipped %llu unchanged entries (%llu bytes).\n", stats.extracted_entries,
+         stats.extracted_bytes, stats.skipped_entries, stats.skipped_bytes);
+  _tprintf(_T("Extracted %s to %s successfully.\n"), zip_file, target_dir);
+
+  return 0;
 }
 
 int _tmain(int argc, TCHAR *argv[]) {
   _tsetlocale(LC_ALL, _T(""));
 
+  if (argc == 4 && _tcscmp(argv[1], _T("-u")) == 0)
+    return UpdateFromZipFile(argv[2], argv[3]);
+
   if (argc != 3) {
     ShowHelp();
     return 0;
   }
+
+  if (_tcscmp(argv[1], _T("-t")) == 0)
+    return TestZipFile(argv[2]);
+  if (_tcscmp(argv[1], _T("-l")) == 0)
+    return ListZipFile(argv[2]);
+  if (_tcscmp(argv[1], _T("-")) == 0)
+    return ExtractFromStdin(argv[2]);
+
   const TCHAR *zip_file = argv[1];
   const TCHAR *target_dir = argv[2];
 
@@ -2,6 +2,10 @@
 #include <locale.h>
 #include <stdio.h>
 #include <zlibwrap/zlibwrap.h>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
 
 #ifndef _WIN32
 #define _T(s) s
@@ -9,10 +13,30 @@
 #define _tmain main
 #define _tsetlocale setlocale
 #define _tprintf printf
+#define _ftprintf fprintf
+#define _tcscmp strcmp
 #endif
 
 void ShowHelp() {
   _tprintf(_T("Usage: zip <zip_file> <source_file_pattern>\n"));
+  _tprintf(_T("       zip - <source_file_pattern>    (write to stdout)\n"));
+}
+
+bool WriteToStdout(void *context, const void *data, size_t size) {
+  return fwrite(data, 1, size, stdout) == size;
+}
+
+int CompressToStdout(const TCHAR *source_file_pattern) {
+#ifdef _WIN32
+  _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+  if (!zlibwrap::ZipCompress(WriteToStdout, NULL, source_file_pattern) || fflush(stdout) != 0) {
+    _ftprintf(stderr, _T("Failed to compress %s to stdout.\n"), source_file_pattern);
+    return -1;
+  }
+
+  return 0;
 }
 
 int _tmain(int argc, const TCHAR *argv[]) {
@@ -25,6 +49,9 @@ int _tmain(int argc, const TCHAR *argv[]) {
   const TCHAR *zip_file = argv[1];
   const TCHAR *source_file_pattern = argv[2];
 
+  if (_tcscmp(zip_file, _T("-")) == 0)
+    return CompressToStdout(source_file_pattern);
+
   if (!zlibwrap::ZipCompress(zip_file, source_file_pattern)) {
     _tprintf(_T("Failed to compress %s to %s.\n"), source_file_pattern, zip_file);
     return -1;
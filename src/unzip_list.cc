@@ -0,0 +1,184 @@
+#include "zip.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+const size_t END_OF_CENTRAL_DIR_SIZE = 22;
+const size_t ZIP64_END_OF_CENTRAL_DIR_LOCATOR_SIZE = 20;
+const size_t ZIP64_END_OF_CENTRAL_DIR_SIZE = 56;
+const size_t CENTRAL_HEADER_SIZE = 46;
+
+// Same fields as minizip's unz_file_info64::tmu_date, in the layout of struct tm.
+void DosDateToTm(uLong dos_date, tm *date) {
+  tm_unz tmu_date;
+  DosDateToTmuDate(dos_date, &tmu_date);
+  memset(date, 0, sizeof(tm));
+  date->tm_mday = (int)tmu_date.tm_mday;
+  date->tm_mon = (int)tmu_date.tm_mon;
+  date->tm_year = (int)tmu_date.tm_year - 1900;
+  date->tm_hour = (int)tmu_date.tm_hour;
+  date->tm_min = (int)tmu_date.tm_min;
+  date->tm_sec = (int)tmu_date.tm_sec;
+  date->tm_isdst = -1;
+}
+
+class ZipFileReader {
+public:
+  ZipFileReader(const void *zip_file, zlib_filefunc64_def *filefunc) : filefunc_(filefunc) {
+    stream_ = filefunc_->zopen64_file(filefunc_->opaque, zip_file,
+                                      ZLIB_FILEFUNC_MODE_READ | ZLIB_FILEFUNC_MODE_EXISTING);
+  }
+
+  ~ZipFileReader() {
+    if (stream_ != NULL)
+      filefunc_->zclose_file(filefunc_->opaque, stream_);
+  }
+
+  bool IsOpened() const {
+    return stream_ != NULL;
+  }
+
+  bool GetSize(ZPOS64_T *size) {
+    if (filefunc_->zseek64_file(filefunc_->opaque, stream_, 0, ZLIB_FILEFUNC_SEEK_END) != 0)
+      return false;
+    *size = filefunc_->ztell64_file(filefunc_->opaque, stream_);
+    return *size != (ZPOS64_T)-1;
+  }
+
+  bool Read(ZPOS64_T offset, void *data, size_t size) {
+    if (filefunc_->zseek64_file(filefunc_->opaque, stream_, offset, ZLIB_FILEFUNC_SEEK_SET) != 0)
+      return false;
+    unsigned char *p = (unsigned char *)data;
+    while (size > 0) {
+      uLong chunk_size = (uLong)std::min<size_t>(size, 1 << 30);
+      if (filefunc_->zread_file(filefunc_->opaque, stream_, p, chunk_size) != chunk_size)
+        return false;
+      p += chunk_size;
+      size -= chunk_size;
+    }
+    return true;
+  }
+
+private:
+  ZipFileReader(const ZipFileReader &) = delete;
+  ZipFileReader &operator=(const ZipFileReader &) = delete;
+
+  zlib_filefunc64_def *filefunc_;
+  voidpf stream_;
+};
+
+} // namespace
+
+bool ZipListArchive(const void *zip_file,
+                    zlib_filefunc64_def *filefunc,
+                    zlibwrap::ZipListCallback callback,
+                    void *context) {
+  ZipFileReader reader(zip_file, filefunc);
+  if (!reader.IsOpened())
+    return false;
+
+  ZPOS64_T file_size = 0;
+  if (!reader.GetSize(&file_size) || file_size < END_OF_CENTRAL_DIR_SIZE)
+    return false;
+
+  // The end of central directory record is followed by a comment of at most 64 KiB, and preceded by the ZIP64 locator.
+  size_t tail_size = (size_t)std::min<ZPOS64_T>(
+      file_size, ZIP64_END_OF_CENTRAL_DIR_LOCATOR_SIZE + END_OF_CENTRAL_DIR_SIZE + MAX_UINT16);
+  ZPOS64_T tail_offset = file_size - tail_size;
+  std::vector<unsigned char> buffer(tail_size);
+  if (!reader.Read(tail_offset, &buffer[0], tail_size))
+    return false;
+
+  size_t end_pos = tail_size - END_OF_CENTRAL_DIR_SIZE;
+  while (GetUInt32(&buffer[end_pos]) != ZIP_END_OF_CENTRAL_DIR_SIGNATURE) {
+    if (end_pos == 0)
+      return false;
+    --end_pos;
+  }
+  const unsigned char *end = &buffer[end_pos];
+  ZPOS64_T end_offset = tail_offset + end_pos;
+  ZPOS64_T entry_count = GetUInt16(end + 10);
+  ZPOS64_T central_dir_size = GetUInt32(end + 12);
+  ZPOS64_T central_dir_offset = GetUInt32(end + 16);
+
+  if (end_pos >= ZIP64_END_OF_CENTRAL_DIR_LOCATOR_SIZE) {
+    const unsigned char *locator = end - ZIP64_END_OF_CENTRAL_DIR_LOCATOR_SIZE;
+    if (GetUInt32(locator) == ZIP64_END_OF_CENTRAL_DIR_LOCATOR_SIGNATURE) {
+      end_offset = GetUInt64(locator + 8);
+      unsigned char zip64_end[ZIP64_END_OF_CENTRAL_DIR_SIZE];
+      if (!reader.Read(end_offset, zip64_end, sizeof(zip64_end)) ||
+          GetUInt32(zip64_end) != ZIP64_END_OF_CENTRAL_DIR_SIGNATURE)
+        return false;
+      entry_count = GetUInt64(zip64_end + 32);
+      central_dir_size = GetUInt64(zip64_end + 40);
+      central_dir_offset = GetUInt64(zip64_end + 48);
+    }
+  }
+
+  // Data prepended to the archive, such as a self-extractor, shifts all offsets, as minizip takes into account.
+  if (central_dir_offset + central_dir_size > end_offset || central_dir_size > (size_t)-1)
+    return false;
+  ZPOS64_T central_dir_pos = end_offset - central_dir_size;
+
+  buffer.resize((size_t)central_dir_size);
+  if (central_dir_size > 0 && !reader.Read(central_dir_pos, &buffer[0], (size_t)central_dir_size))
+    return false;
+
+  zlibwrap::ZipEntryInfo entry = {};
+  const unsigned char *p = buffer.data();
+  const unsigned char *central_dir_end = p + buffer.size();
+  for (ZPOS64_T i = 0; i < entry_count; ++i) {
+    if ((size_t)(central_dir_end - p) < CENTRAL_HEADER_SIZE || GetUInt32(p) != ZIP_CENTRAL_HEADER_SIGNATURE)
+      return false;
+    size_t inner_path_size = GetUInt16(p + 28);
+    size_t extra_size = GetUInt16(p + 30);
+    size_t comment_size = GetUInt16(p + 32);
+    const unsigned char *extra = p + CENTRAL_HEADER_SIZE + inner_path_size;
+    const unsigned char *next = extra + extra_size + comment_size;
+    if ((size_t)(central_dir_end - p) < CENTRAL_HEADER_SIZE + inner_path_size + extra_size + comment_size)
+      return false;
+
+    entry.inner_path = (const char *)p + CENTRAL_HEADER_SIZE;
+    entry.inner_path_size = inner_path_size;
+    entry.flag = GetUInt16(p + 8);
+    entry.compression_method = GetUInt16(p + 10);
+    entry.dos_date = GetUInt32(p + 12);
+    entry.crc = GetUInt32(p + 16);
+    DosDateToTm(entry.dos_date, &entry.modified_time);
+
+    // Sizes saturated to 0xffffffff are stored in the ZIP64 extra field, uncompressed size first.
+    ZPOS64_T compressed_size = GetUInt32(p + 20);
+    ZPOS64_T uncompressed_size = GetUInt32(p + 24);
+    ZPOS64_T *sizes[] = {&uncompressed_size, &compressed_size};
+    if (!ParseZip64Extra(extra, extra_size, sizes, 2, NULL))
+      return false;
+    entry.compressed_size = compressed_size;
+    entry.uncompressed_size = uncompressed_size;
+
+    if (!callback(context, entry))
+      return false;
+    p = next;
+  }
+
+  return true;
+}
+
+namespace zlibwrap {
+
+#ifdef _WIN32
+bool ZipList(const TCHAR *zip_file, ZipListCallback callback, void *context) {
+  zlib_filefunc64_def filefunc;
+  ZipFillFileFunc(&filefunc);
+  return ZipListArchive(zip_file, &filefunc, callback, context);
+}
+#else
+bool ZipList(const char *zip_file, ZipListCallback callback, void *context) {
+  zlib_filefunc64_def filefunc;
+  ZipFillFileFunc(&filefunc);
+  return ZipListArchive(zip_file, &filefunc, callback, context);
+}
+#endif
+
+} // namespace zlibwrap
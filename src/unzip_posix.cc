@@ -1,4 +1,6 @@
+#include "unzip_reader.h"
 #include "zip.h"
+#include <cctype>
 #include <cstring>
 #include <ctime>
 #include <loki/ScopeGuard.h>
@@ -6,6 +8,7 @@
 #include <string>
 #include <sys/stat.h>
 #include <utime.h>
+#include <vector>
 #include <zlibwrap/zlibwrap.h>
 
 namespace {
@@ -18,23 +21,108 @@ void mkdirs(char *path) {
   }
 }
 
-bool ZipExtractCurrentFile(unzFile uf, const std::string &target_dir) {
-  std::string inner_path;
-  inner_path.resize(1024);
+time_t ZipTmuDateToTime(const tm_unz &tmu_date) {
+  tm date = {};
+  date.tm_sec = tmu_date.tm_sec;
+  date.tm_min = tmu_date.tm_min;
+  date.tm_hour = tmu_date.tm_hour;
+  date.tm_mday = tmu_date.tm_mday;
+  date.tm_mon = tmu_date.tm_mon;
+  if (tmu_date.tm_year > 1900)
+    date.tm_year = tmu_date.tm_year - 1900;
+  else
+    date.tm_year = tmu_date.tm_year;
+  date.tm_isdst = -1;
+  return mktime(&date);
+}
+
+void ZipSetFileTime(const std::string &target_path, const tm_unz &tmu_date) {
+  utimbuf ut = {};
+  ut.actime = ut.modtime = ZipTmuDateToTime(tmu_date);
+  utime(target_path.c_str(), &ut);
+}
+
+bool ZipIsFileUnchanged(const std::string &target_path, const unz_file_info64 &file_info, bool compare_crc) {
+  struct stat st = {};
+  if (stat(target_path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+    return false;
+  if ((ZPOS64_T)st.st_size != file_info.uncompressed_size)
+    return false;
+  double time_diff = difftime(st.st_mtime, ZipTmuDateToTime(file_info.tmu_date));
+  if (time_diff <= -2 || time_diff >= 2)
+    return false;
+  if (!compare_crc)
+    return true;
+
+  FILE *f = fopen(target_path.c_str(), "rb");
+  if (f == NULL)
+    return false;
+  LOKI_ON_BLOCK_EXIT(fclose, f);
+
+  const size_t BUFFER_SIZE = 4096;
+  unsigned char buffer[BUFFER_SIZE] = {};
+  uLong crc = crc32(0, NULL, 0);
+  while (!feof(f)) {
+    size_t size = fread(buffer, 1, BUFFER_SIZE, f);
+    if (size < BUFFER_SIZE && ferror(f))
+      return false;
+    crc = crc32(crc, buffer, (uInt)size);
+  }
+  return crc == file_info.crc;
+}
+
+// Rejects paths which would escape the target directory: absolute, with a drive prefix, or with a ".." component.
+bool ZipIsSafeInnerPath(const char *inner_path, size_t size) {
+  if (size == 0 || inner_path[0] == '/' || inner_path[0] == '\\')
+    return false;
+  if (size >= 2 && isalpha((unsigned char)inner_path[0]) && inner_path[1] == ':')
+    return false;
+  for (size_t begin = 0, end = 0; begin <= size; begin = end + 1) {
+    for (end = begin; end < size && inner_path[end] != '/' && inner_path[end] != '\\'; ++end)
+      ;
+    if (end - begin == 2 && inner_path[begin] == '.' && inner_path[begin + 1] == '.')
+      return false;
+  }
+  return true;
+}
+
+// inner_path_buffer is reused across entries, and grows only for names longer than any before.
+bool ZipExtractCurrentFile(unzFile uf,
+                           const std::string &target_dir,
+                           std::vector<char> *inner_path_buffer,
+                           unsigned int flags,
+                           zlibwrap::ZipExtractStats *stats,
+                           ZipProgressReporter *progress) {
   unz_file_info64 file_info;
-  char *inner_path_buffer = &inner_path[0];
-  if (unzGetCurrentFileInfo64(uf, &file_info, inner_path_buffer, (uLong)inner_path.size(), NULL, 0, NULL, 0) != UNZ_OK)
+  if (unzGetCurrentFileInfo64(uf, &file_info, &(*inner_path_buffer)[0], (uLong)inner_path_buffer->size(), NULL, 0,
+                              NULL, 0) != UNZ_OK)
     return false;
-  inner_path.resize(strlen(inner_path.c_str()));
+  if (file_info.size_filename >= inner_path_buffer->size()) {
+    inner_path_buffer->resize(file_info.size_filename + 1);
+    if (unzGetCurrentFileInfo64(uf, &file_info, &(*inner_path_buffer)[0], (uLong)inner_path_buffer->size(), NULL, 0,
+                                NULL, 0) != UNZ_OK)
+      return false;
+  }
+  const char *inner_path = &(*inner_path_buffer)[0];
+  if (!ZipIsSafeInnerPath(inner_path, file_info.size_filename))
+    return false;
+
+  std::string target_path = target_dir;
+  target_path.append(inner_path, file_info.size_filename);
+  mkdirs(&target_path[0]);
+  bool is_dir = inner_path[file_info.size_filename - 1] == '/';
+
+  if (!is_dir && (flags & zlibwrap::ZIP_EXTRACT_SKIP_UNCHANGED) != 0 &&
+      ZipIsFileUnchanged(target_path, file_info, (flags & zlibwrap::ZIP_EXTRACT_COMPARE_CRC) != 0)) {
+    ++stats->skipped_entries;
+    stats->skipped_bytes += file_info.uncompressed_size;
+    return progress->Report(file_info.uncompressed_size);
+  }
 
   if (unzOpenCurrentFile(uf) != UNZ_OK)
     return false;
   LOKI_ON_BLOCK_EXIT(unzCloseCurrentFile, uf);
 
-  std::string target_path = target_dir + inner_path;
-  mkdirs(&target_path[0]);
-  bool is_dir = *inner_path.rbegin() == '/';
-
   if (!is_dir) {
     FILE *f = fopen(target_path.c_str(), "wb");
     if (f == NULL)
@@ -49,42 +137,83 @@ bool ZipExtractCurrentFile(unzFile uf, const std::string &target_dir) {
         return false;
       if (size == 0)
         break;
-      if (fwrite(buffer, 1, size, f) != size)
+      if (fwrite(buffer, 1, size, f) != (size_t)size)
+        return false;
+      stats->extracted_bytes += size;
+      if (!progress->Report(size))
         return false;
     }
   }
 
-  tm date = {};
-  date.tm_sec = file_info.tmu_date.tm_sec;
-  date.tm_min = file_info.tmu_date.tm_min;
-  date.tm_hour = file_info.tmu_date.tm_hour;
-  date.tm_mday = file_info.tmu_date.tm_mday;
-  date.tm_mon = file_info.tmu_date.tm_mon;
-  if (file_info.tmu_date.tm_year > 1900)
-    date.tm_year = file_info.tmu_date.tm_year - 1900;
-  else
-    date.tm_year = file_info.tmu_date.tm_year;
-  date.tm_isdst = -1;
+  ++stats->extracted_entries;
+  ZipSetFileTime(target_path, file_info.tmu_date);
+  return true;
+}
 
-  utimbuf ut = {};
-  ut.actime = ut.modtime = mktime(&date);
-  utime(target_path.c_str(), &ut);
+bool ZipExtractStreamEntry(ZipStreamReader &reader, const ZipStreamEntry &entry, const std::string &target_dir) {
+  if (!ZipIsSafeInnerPath(entry.inner_path.c_str(), entry.inner_path.size()))
+    return false;
+
+  std::string target_path = target_dir + entry.inner_path;
+  mkdirs(&target_path[0]);
+  bool is_dir = *entry.inner_path.rbegin() == '/';
+
+  if (!is_dir) {
+    FILE *f = fopen(target_path.c_str(), "wb");
+    if (f == NULL)
+      return false;
+    LOKI_ON_BLOCK_EXIT(fclose, f);
+
+    const size_t BUFFER_SIZE = 4096;
+    unsigned char buffer[BUFFER_SIZE] = {};
+    while (true) {
+      int size = reader.ReadEntry(buffer, BUFFER_SIZE);
+      if (size < 0)
+        return false;
+      if (size == 0)
+        break;
+      if (fwrite(buffer, 1, size, f) != (size_t)size)
+        return false;
+    }
+  }
+
+  ZipSetFileTime(target_path, entry.tmu_date);
   return true;
 }
 
 } // namespace
 
-namespace zlibwrap {
-
-bool ZipExtract(const char *zip_file, const char *target_dir) {
-  unzFile uf = unzOpen64(zip_file);
-  if (uf == NULL)
-    return false;
-  LOKI_ON_BLOCK_EXIT(unzClose, uf);
+void ZipFillFileFunc(zlib_filefunc64_def *filefunc) {
+  fill_fopen64_filefunc(filefunc);
+}
 
+bool ZipExtractArchive(unzFile uf,
+                       const char *target_dir,
+                       unsigned int flags,
+                       zlibwrap::ZipExtractStats *stats,
+                       ZipProgressReporter *progress) {
   unz_global_info64 gi = {};
   if (unzGetGlobalInfo64(uf, &gi) != UNZ_OK)
     return false;
+  if (gi.number_entry > 0 && unzGoToFirstFile(uf) != UNZ_OK)
+    return false;
+
+  if (progress->IsEnabled()) {
+    ZPOS64_T total_size = 0;
+    for (ZPOS64_T i = 0; i < gi.number_entry; ++i) {
+      unz_file_info64 file_info = {};
+      if (unzGetCurrentFileInfo64(uf, &file_info, NULL, 0, NULL, 0, NULL, 0) != UNZ_OK)
+        return false;
+      total_size += file_info.uncompressed_size;
+      if (i < gi.number_entry - 1) {
+        if (unzGoToNextFile(uf) != UNZ_OK)
+          return false;
+      }
+    }
+    progress->SetTotalSize(total_size);
+    if (gi.number_entry > 0 && unzGoToFirstFile(uf) != UNZ_OK)
+      return false;
+  }
 
   std::string root_dir = target_dir;
   if (!root_dir.empty() && (*root_dir.rbegin() != '\\' && *root_dir.rbegin() != '/'))
@@ -92,8 +221,9 @@ bool ZipExtract(const char *zip_file, const char *target_dir) {
   char *root_dir_buffer = &root_dir[0];
   mkdirs(root_dir_buffer);
 
-  for (int i = 0; i < gi.number_entry; ++i) {
-    if (!ZipExtractCurrentFile(uf, root_dir))
+  std::vector<char> inner_path_buffer(1024);
+  for (ZPOS64_T i = 0; i < gi.number_entry; ++i) {
+    if (!ZipExtractCurrentFile(uf, root_dir, &inner_path_buffer, flags, stats, progress))
       return false;
     if (i < gi.number_entry - 1) {
       if (unzGoToNextFile(uf) != UNZ_OK)
@@ -104,4 +234,47 @@ bool ZipExtract(const char *zip_file, const char *target_dir) {
   return true;
 }
 
+namespace zlibwrap {
+
+bool ZipExtract(const char *zip_file, const char *target_dir) {
+  return ZipExtract(zip_file, target_dir, 0, NULL);
+}
+
+bool ZipExtract(const char *zip_file, const char *target_dir, unsigned int flags, ZipExtractStats *stats) {
+  unzFile uf = unzOpen64(zip_file);
+  if (uf == NULL)
+    return false;
+  LOKI_ON_BLOCK_EXIT(unzClose, uf);
+
+  ZipExtractStats local_stats = {};
+  ZipProgressReporter progress;
+  bool result = ZipExtractArchive(uf, target_dir, flags, &local_stats, &progress);
+  if (stats != NULL)
+    *stats = local_stats;
+  return result;
+}
+
+bool ZipExtract(ZipSource source, void *context, const char *target_dir, bool verify_central_directory) {
+  ZipStreamReader reader(source, context, verify_central_directory);
+
+  std::string root_dir = target_dir;
+  if (!root_dir.empty() && (*root_dir.rbegin() != '\\' && *root_dir.rbegin() != '/'))
+    root_dir += "/";
+  char *root_dir_buffer = &root_dir[0];
+  mkdirs(root_dir_buffer);
+
+  ZipStreamEntry entry;
+  while (true) {
+    int result = reader.NextEntry(&entry);
+    if (result < 0)
+      return false;
+    if (result == 0)
+      break;
+    if (!ZipExtractStreamEntry(reader, entry, root_dir))
+      return false;
+  }
+
+  return !verify_central_directory || reader.VerifyCentralDirectory();
+}
+
 } // namespace zlibwrap
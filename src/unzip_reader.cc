@@ -0,0 +1,302 @@
+#include "unzip_reader.h"
+#include "zip.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const size_t BUFFER_SIZE = 64 * 1024;
+
+// Written at the beginning of archives split into a single segment.
+const uLong ZIP_SPANNING_SIGNATURE = 0x30304b50;
+
+} // namespace
+
+ZipStreamReader::ZipStreamReader(zlibwrap::ZipSource source, void *context, bool keep_records)
+    : source_(source), context_(context), buffer_(BUFFER_SIZE), buffer_pos_(0), buffer_size_(0), offset_(0),
+      stream_(), stream_initialized_(false), entry_(), record_(), has_zip64_extra_(false), entry_opened_(false),
+      entry_finished_(false), read_crc_(0), read_compressed_size_(0), read_uncompressed_size_(0),
+      keep_records_(keep_records), end_signature_(0), central_dir_offset_(0) {
+}
+
+ZipStreamReader::~ZipStreamReader() {
+  if (stream_initialized_)
+    inflateEnd(&stream_);
+}
+
+int ZipStreamReader::NextEntry(ZipStreamEntry *entry) {
+  if (end_signature_ != 0)
+    return 0;
+  if (entry_opened_ && !entry_finished_) {
+    unsigned char buffer[4096];
+    while (true) {
+      int size = ReadEntry(buffer, sizeof(buffer));
+      if (size < 0)
+        return size;
+      if (size == 0)
+        break;
+    }
+  }
+  entry_opened_ = false;
+
+  unsigned char header[30];
+  ZPOS64_T header_offset = offset_;
+  if (!Read(header, 4))
+    return UNZ_BADZIPFILE;
+  uLong signature = GetUInt32(header);
+  if (header_offset == 0 && signature == ZIP_SPANNING_SIGNATURE) {
+    header_offset = offset_;
+    if (!Read(header, 4))
+      return UNZ_BADZIPFILE;
+    signature = GetUInt32(header);
+  }
+  if (signature == ZIP_CENTRAL_HEADER_SIGNATURE || signature == ZIP_END_OF_CENTRAL_DIR_SIGNATURE) {
+    end_signature_ = signature;
+    central_dir_offset_ = header_offset;
+    return 0;
+  }
+  if (signature != ZIP_LOCAL_HEADER_SIGNATURE)
+    return UNZ_BADZIPFILE;
+  if (!Read(header + 4, sizeof(header) - 4))
+    return UNZ_BADZIPFILE;
+
+  entry_.flag = GetUInt16(header + 6);
+  entry_.compression_method = GetUInt16(header + 8);
+  entry_.dos_date = GetUInt32(header + 10);
+  DosDateToTmuDate(entry_.dos_date, &entry_.tmu_date);
+  record_.crc = GetUInt32(header + 14);
+  record_.compressed_size = GetUInt32(header + 18);
+  record_.uncompressed_size = GetUInt32(header + 22);
+  record_.offset = header_offset;
+
+  entry_.inner_path.resize(GetUInt16(header + 26));
+  extra_.resize(GetUInt16(header + 28));
+  if (!entry_.inner_path.empty() && !Read(&entry_.inner_path[0], entry_.inner_path.size()))
+    return UNZ_BADZIPFILE;
+  if (!extra_.empty() && !Read(&extra_[0], extra_.size()))
+    return UNZ_BADZIPFILE;
+  ZPOS64_T *sizes[] = {&record_.uncompressed_size, &record_.compressed_size};
+  if (!ParseZip64Extra(extra_.data(), extra_.size(), sizes, 2, &has_zip64_extra_))
+    return UNZ_BADZIPFILE;
+
+  // Encrypted entries are not supported.
+  if ((entry_.flag & 1) != 0)
+    return UNZ_BADZIPFILE;
+  if (entry_.compression_method == Z_DEFLATED) {
+    int result = stream_initialized_ ? inflateReset(&stream_) : inflateInit2(&stream_, -MAX_WBITS);
+    if (result != Z_OK)
+      return UNZ_INTERNALERROR;
+    stream_initialized_ = true;
+  } else if (entry_.compression_method != 0 || (entry_.flag & ZIP_GPBF_DATA_DESCRIPTOR_FLAG) != 0) {
+    return UNZ_BADZIPFILE;
+  }
+
+  entry_opened_ = true;
+  entry_finished_ = false;
+  read_crc_ = 0;
+  read_compressed_size_ = 0;
+  read_uncompressed_size_ = 0;
+  *entry = entry_;
+  return 1;
+}
+
+int ZipStreamReader::ReadEntry(void *buffer, unsigned int size) {
+  if (!entry_opened_)
+    return UNZ_PARAMERROR;
+  if (entry_finished_ || size == 0)
+    return 0;
+
+  unsigned int read_size = 0;
+  bool end = false;
+  if (entry_.compression_method == 0) {
+    ZPOS64_T rest_size = record_.compressed_size - read_compressed_size_;
+    if (rest_size > 0) {
+      if (buffer_pos_ == buffer_size_ && !Fill())
+        return UNZ_BADZIPFILE;
+      read_size = (unsigned int)std::min(std::min((ZPOS64_T)size, rest_size), (ZPOS64_T)(buffer_size_ - buffer_pos_));
+      memcpy(buffer, &buffer_[buffer_pos_], read_size);
+      Consume(read_size);
+      read_compressed_size_ += read_size;
+    }
+    end = read_compressed_size_ == record_.compressed_size;
+  } else {
+    stream_.next_out = (Bytef *)buffer;
+    stream_.avail_out = size;
+    while (stream_.avail_out == size) {
+      if (buffer_pos_ == buffer_size_ && !Fill())
+        return UNZ_BADZIPFILE;
+      stream_.next_in = &buffer_[buffer_pos_];
+      stream_.avail_in = (uInt)(buffer_size_ - buffer_pos_);
+      int result = inflate(&stream_, Z_NO_FLUSH);
+      size_t consumed_size = buffer_size_ - buffer_pos_ - stream_.avail_in;
+      Consume(consumed_size);
+      read_compressed_size_ += consumed_size;
+      if (result == Z_STREAM_END) {
+        end = true;
+        break;
+      }
+      if (result != Z_OK)
+        return UNZ_BADZIPFILE;
+    }
+    read_size = size - stream_.avail_out;
+  }
+
+  read_crc_ = crc32(read_crc_, (const Bytef *)buffer, read_size);
+  read_uncompressed_size_ += read_size;
+  if (end && !FinishEntry())
+    return UNZ_CRCERROR;
+  return (int)read_size;
+}
+
+bool ZipStreamReader::VerifyCentralDirectory() {
+  if (end_signature_ == 0)
+    return false;
+
+  unsigned char header[46];
+  uLong signature = end_signature_;
+  size_t index = 0;
+  std::string inner_path;
+  while (signature == ZIP_CENTRAL_HEADER_SIGNATURE) {
+    if (!Read(header + 4, sizeof(header) - 4))
+      return false;
+    Record record = {};
+    record.crc = GetUInt32(header + 16);
+    record.compressed_size = GetUInt32(header + 20);
+    record.uncompressed_size = GetUInt32(header + 24);
+    record.offset = GetUInt32(header + 42);
+    inner_path.resize(GetUInt16(header + 28));
+    extra_.resize(GetUInt16(header + 30));
+    uLong comment_size = GetUInt16(header + 32);
+    if (!inner_path.empty() && !Read(&inner_path[0], inner_path.size()))
+      return false;
+    if (!extra_.empty() && !Read(&extra_[0], extra_.size()))
+      return false;
+    if (!Skip(comment_size))
+      return false;
+    ZPOS64_T *fields[] = {&record.uncompressed_size, &record.compressed_size, &record.offset};
+    if (!ParseZip64Extra(extra_.data(), extra_.size(), fields, 3, NULL))
+      return false;
+
+    if (index >= records_.size())
+      return false;
+    const Record &expected = records_[index++];
+    if (inner_path != expected.inner_path || record.crc != expected.crc ||
+        record.compressed_size != expected.compressed_size || record.uncompressed_size != expected.uncompressed_size ||
+        record.offset != expected.offset)
+      return false;
+
+    if (!Read(header, 4))
+      return false;
+    signature = GetUInt32(header);
+  }
+  if (index != records_.size())
+    return false;
+  ZPOS64_T central_dir_size = offset_ - 4 - central_dir_offset_;
+
+  if (signature == ZIP64_END_OF_CENTRAL_DIR_SIGNATURE) {
+    unsigned char end[56];
+    if (!Read(end + 4, sizeof(end) - 4))
+      return false;
+    ZPOS64_T record_size = GetUInt64(end + 4);
+    if (record_size < 44 || !Skip(record_size - 44))
+      return false;
+    if (GetUInt64(end + 32) != records_.size() || GetUInt64(end + 40) != central_dir_size ||
+        GetUInt64(end + 48) != central_dir_offset_)
+      return false;
+    unsigned char locator[20];
+    if (!Read(locator, sizeof(locator)) || GetUInt32(locator) != ZIP64_END_OF_CENTRAL_DIR_LOCATOR_SIGNATURE)
+      return false;
+    if (!Read(header, 4))
+      return false;
+    signature = GetUInt32(header);
+  }
+
+  if (signature != ZIP_END_OF_CENTRAL_DIR_SIGNATURE)
+    return false;
+  unsigned char end[22];
+  if (!Read(end + 4, sizeof(end) - 4))
+    return false;
+  ZPOS64_T entry_count = GetUInt16(end + 10);
+  ZPOS64_T end_central_dir_size = GetUInt32(end + 12);
+  ZPOS64_T end_central_dir_offset = GetUInt32(end + 16);
+  if ((entry_count != MAX_UINT16 && entry_count != records_.size()) ||
+      (end_central_dir_size != MAX_UINT32 && end_central_dir_size != central_dir_size) ||
+      (end_central_dir_offset != MAX_UINT32 && end_central_dir_offset != central_dir_offset_))
+    return false;
+  return true;
+}
+
+bool ZipStreamReader::Fill() {
+  buffer_pos_ = 0;
+  buffer_size_ = buffer_.size();
+  if (!source_(context_, &buffer_[0], &buffer_size_) || buffer_size_ > buffer_.size()) {
+    buffer_size_ = 0;
+    return false;
+  }
+  return buffer_size_ > 0;
+}
+
+void ZipStreamReader::Consume(size_t size) {
+  buffer_pos_ += size;
+  offset_ += size;
+}
+
+bool ZipStreamReader::Read(void *data, size_t size) {
+  unsigned char *p = (unsigned char *)data;
+  while (size > 0) {
+    if (buffer_pos_ == buffer_size_ && !Fill())
+      return false;
+    size_t copy_size = std::min(size, buffer_size_ - buffer_pos_);
+    memcpy(p, &buffer_[buffer_pos_], copy_size);
+    Consume(copy_size);
+    p += copy_size;
+    size -= copy_size;
+  }
+  return true;
+}
+
+bool ZipStreamReader::Skip(ZPOS64_T size) {
+  while (size > 0) {
+    if (buffer_pos_ == buffer_size_ && !Fill())
+      return false;
+    size_t skip_size = (size_t)std::min(size, (ZPOS64_T)(buffer_size_ - buffer_pos_));
+    Consume(skip_size);
+    size -= skip_size;
+  }
+  return true;
+}
+
+bool ZipStreamReader::FinishEntry() {
+  entry_finished_ = true;
+  if ((entry_.flag & ZIP_GPBF_DATA_DESCRIPTOR_FLAG) != 0) {
+    unsigned char descriptor[16];
+    if (!Read(descriptor, 4))
+      return false;
+    // The signature of data descriptor is optional.
+    if (GetUInt32(descriptor) == ZIP_DATA_DESCRIPTOR_SIGNATURE && !Read(descriptor, 4))
+      return false;
+    record_.crc = GetUInt32(descriptor);
+    // Sizes are 8 bytes if announced by a ZIP64 extra field, or if they do not fit in 4 bytes.
+    if (has_zip64_extra_ || read_compressed_size_ >= MAX_UINT32 || read_uncompressed_size_ >= MAX_UINT32) {
+      if (!Read(descriptor, 16))
+        return false;
+      record_.compressed_size = GetUInt64(descriptor);
+      record_.uncompressed_size = GetUInt64(descriptor + 8);
+    } else {
+      if (!Read(descriptor, 8))
+        return false;
+      record_.compressed_size = GetUInt32(descriptor);
+      record_.uncompressed_size = GetUInt32(descriptor + 4);
+    }
+  }
+
+  if (read_crc_ != record_.crc || read_compressed_size_ != record_.compressed_size ||
+      read_uncompressed_size_ != record_.uncompressed_size)
+    return false;
+
+  if (keep_records_) {
+    records_.push_back(record_);
+    records_.back().inner_path = entry_.inner_path;
+  }
+  return true;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <minizip/unzip.h>
+#include <string>
+#include <vector>
+#include <zlibwrap/zlibwrap.h>
+
+/**
+ * @brief Entry read from a local file header.
+ */
+struct ZipStreamEntry {
+  std::string inner_path;
+  uLong flag;
+  uLong compression_method;
+  uLong dos_date;
+  tm_unz tmu_date;
+};
+
+/**
+ * @brief Reads entries from a source in a single forward pass, never seeking.
+ *
+ * Local file headers are parsed one after another, and data of each entry is inflated as bytes arrive. Entries with
+ * general purpose bit 3 set are checked against their data descriptors, others against their local headers. Stored
+ * entries with bit 3 set are rejected, since their end can not be found without the central directory.
+ */
+class ZipStreamReader {
+public:
+  /**
+   * @param source       Callback providing ZIP data.
+   * @param context      Context passed to source.
+   * @param keep_records Whether to keep entries read for VerifyCentralDirectory().
+   */
+  ZipStreamReader(zlibwrap::ZipSource source, void *context, bool keep_records);
+  ~ZipStreamReader();
+
+  /**
+   * @brief Move to the next entry, skipping what is left of the current one.
+   *
+   * @param entry Receives the entry found.
+   * @return 1 if an entry is found, 0 if the central directory is reached, negative on error.
+   */
+  int NextEntry(ZipStreamEntry *entry);
+
+  /**
+   * @brief Read data of the current entry. CRC32 and sizes are checked when the end of the entry is reached.
+   *
+   * @param buffer Buffer to receive data.
+   * @param size   Size of buffer in bytes.
+   * @return Number of bytes read, 0 at the end of the entry, negative on error.
+   */
+  int ReadEntry(void *buffer, unsigned int size);
+
+  /**
+   * @brief Read the central directory following the last entry, and check it against the entries read.
+   *
+   * @return true/false
+   */
+  bool VerifyCentralDirectory();
+
+private:
+  ZipStreamReader(const ZipStreamReader &) = delete;
+  ZipStreamReader &operator=(const ZipStreamReader &) = delete;
+
+  struct Record {
+    std::string inner_path;
+    uLong crc;
+    ZPOS64_T compressed_size;
+    ZPOS64_T uncompressed_size;
+    ZPOS64_T offset;
+  };
+
+  bool Fill();
+  void Consume(size_t size);
+  bool Read(void *data, size_t size);
+  bool Skip(ZPOS64_T size);
+  bool FinishEntry();
+
+  zlibwrap::ZipSource source_;
+  void *context_;
+  std::vector<unsigned char> buffer_;
+  size_t buffer_pos_;
+  size_t buffer_size_;
+  ZPOS64_T offset_;
+  z_stream stream_;
+  bool stream_initialized_;
+
+  ZipStreamEntry entry_;
+  Record record_;
+  bool has_zip64_extra_;
+  bool entry_opened_;
+  bool entry_finished_;
+  uLong read_crc_;
+  ZPOS64_T read_compressed_size_;
+  ZPOS64_T read_uncompressed_size_;
+  std::vector<unsigned char> extra_;
+
+  bool keep_records_;
+  std::vector<Record> records_;
+  uLong end_signature_;
+  ZPOS64_T central_dir_offset_;
+};
@@ -0,0 +1,226 @@
+#include "zip.h"
+#include <algorithm>
+#include <atomic>
+#include <loki/ScopeGuard.h>
+#include <minizip/unzip.h>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <zlibwrap/zlibwrap.h>
+
+namespace {
+
+const size_t BUFFER_SIZE = 64 * 1024;
+
+struct ZipTestContext {
+  const void *zip_file;
+  zlib_filefunc64_def *filefunc;
+  std::vector<unz64_file_pos> entries;
+  std::atomic<size_t> next_entry;
+  std::mutex mutex;
+  std::vector<std::pair<size_t, zlibwrap::ZipTestFailure>> failures;
+  ZipProgressReporter *progress;
+  std::atomic<bool> aborted;
+};
+
+std::string ZipGetCurrentFileName(unzFile uf) {
+  std::string inner_path;
+  unz_file_info64 file_info = {};
+  if (unzGetCurrentFileInfo64(uf, &file_info, NULL, 0, NULL, 0, NULL, 0) != UNZ_OK || file_info.size_filename == 0)
+    return inner_path;
+  inner_path.resize(file_info.size_filename);
+  if (unzGetCurrentFileInfo64(uf, NULL, &inner_path[0], (uLong)inner_path.size(), NULL, 0, NULL, 0) != UNZ_OK)
+    inner_path.clear();
+  return inner_path;
+}
+
+bool ZipTestReportProgress(ZipTestContext *context, unsigned long long size) {
+  std::lock_guard<std::mutex> lock(context->mutex);
+  if (!context->progress->Report(size))
+    context->aborted = true;
+  return !context->aborted;
+}
+
+bool ZipTestEntry(ZipTestContext *context,
+                  unzFile uf,
+                  const unz64_file_pos &entry,
+                  unsigned char *buffer,
+                  zlibwrap::ZipTestError *error) {
+  unz_file_info64 file_info = {};
+  if (unzGoToFilePos64(uf, &entry) != UNZ_OK ||
+      unzGetCurrentFileInfo64(uf, &file_info, NULL, 0, NULL, 0, NULL, 0) != UNZ_OK) {
+    *error = zlibwrap::ZIP_TEST_BAD_HEADER;
+    return false;
+  }
+
+  if (unzOpenCurrentFile(uf) != UNZ_OK) {
+    *error = zlibwrap::ZIP_TEST_BAD_HEADER;
+    return false;
+  }
+
+  ZPOS64_T total_size = 0;
+  while (true) {
+    int size = unzReadCurrentFile(uf, buffer, BUFFER_SIZE);
+    if (size < 0) {
+      unzCloseCurrentFile(uf);
+      *error = zlibwrap::ZIP_TEST_BAD_DATA;
+      return false;
+    }
+    if (size == 0)
+      break;
+    total_size += size;
+    if (context->progress->IsEnabled() && !ZipTestReportProgress(context, size)) {
+      // Aborted by the caller, which is not a failure of this entry.
+      unzCloseCurrentFile(uf);
+      return true;
+    }
+  }
+
+  // minizip only verifies CRC32 when the entry is read to the size recorded in the central directory.
+  int result = unzCloseCurrentFile(uf);
+  if (total_size != file_info.uncompressed_size) {
+    *error = zlibwrap::ZIP_TEST_SIZE_MISMATCH;
+    return false;
+  }
+  if (result == UNZ_CRCERROR) {
+    *error = zlibwrap::ZIP_TEST_CRC_MISMATCH;
+    return false;
+  }
+  if (result != UNZ_OK) {
+    *error = zlibwrap::ZIP_TEST_BAD_DATA;
+    return false;
+  }
+  return true;
+}
+
+// A worker failing to open the ZIP file takes no entries, leaving them to the others.
+void ZipTestWorker(ZipTestContext *context) {
+  unzFile uf = unzOpen2_64(context->zip_file, context->filefunc);
+  if (uf == NULL)
+    return;
+  LOKI_ON_BLOCK_EXIT(unzClose, uf);
+
+  std::vector<unsigned char> buffer(BUFFER_SIZE);
+  for (size_t i = context->next_entry++; i < context->entries.size() && !context->aborted; i = context->next_entry++) {
+    zlibwrap::ZipTestFailure failure;
+    if (ZipTestEntry(context, uf, context->entries[i], &buffer[0], &failure.error))
+      continue;
+    // The current entry of uf is unreliable after a failure, so names are resolved after all workers finish.
+    std::lock_guard<std::mutex> lock(context->mutex);
+    context->failures.push_back(std::make_pair(i, failure));
+  }
+}
+
+// Fill names of failed entries from their positions found by the enumeration, with a fresh handle.
+void ZipTestResolveNames(ZipTestContext *context) {
+  if (context->failures.empty())
+    return;
+  unzFile uf = unzOpen2_64(context->zip_file, context->filefunc);
+  if (uf == NULL)
+    return;
+  LOKI_ON_BLOCK_EXIT(unzClose, uf);
+
+  for (size_t i = 0; i < context->failures.size(); ++i) {
+    if (unzGoToFilePos64(uf, &context->entries[context->failures[i].first]) == UNZ_OK)
+      context->failures[i].second.inner_path = ZipGetCurrentFileName(uf);
+  }
+}
+
+bool ZipTestFailureLess(const std::pair<size_t, zlibwrap::ZipTestFailure> &lhs,
+                        const std::pair<size_t, zlibwrap::ZipTestFailure> &rhs) {
+  return lhs.first < rhs.first;
+}
+
+} // namespace
+
+bool ZipTestArchive(const void *zip_file,
+                    zlib_filefunc64_def *filefunc,
+                    std::vector<zlibwrap::ZipTestFailure> *failures,
+                    unsigned int thread_count,
+                    ZipProgressReporter *progress) {
+  ZipTestContext context;
+  context.zip_file = zip_file;
+  context.filefunc = filefunc;
+  context.next_entry = 0;
+  context.progress = progress;
+  context.aborted = false;
+
+  {
+    unzFile uf = unzOpen2_64(zip_file, filefunc);
+    if (uf == NULL)
+      return false;
+    LOKI_ON_BLOCK_EXIT(unzClose, uf);
+
+    unz_global_info64 gi = {};
+    if (unzGetGlobalInfo64(uf, &gi) != UNZ_OK)
+      return false;
+
+    ZPOS64_T total_size = 0;
+    context.entries.resize((size_t)gi.number_entry);
+    for (size_t i = 0; i < context.entries.size(); ++i) {
+      if (unzGetFilePos64(uf, &context.entries[i]) != UNZ_OK)
+        return false;
+      if (progress->IsEnabled()) {
+        unz_file_info64 file_info = {};
+        if (unzGetCurrentFileInfo64(uf, &file_info, NULL, 0, NULL, 0, NULL, 0) != UNZ_OK)
+          return false;
+        total_size += file_info.uncompressed_size;
+      }
+      if (i < context.entries.size() - 1) {
+        if (unzGoToNextFile(uf) != UNZ_OK)
+          return false;
+      }
+    }
+    progress->SetTotalSize(total_size);
+  }
+
+  if (thread_count == 0)
+    thread_count = std::thread::hardware_concurrency();
+  thread_count = (unsigned int)std::min<size_t>(thread_count, context.entries.size());
+  if (thread_count == 0)
+    thread_count = 1;
+
+  // Each worker opens its own handle, and takes the next untested entry when done with one.
+  std::vector<std::thread> workers;
+  for (unsigned int i = 1; i < thread_count; ++i)
+    workers.push_back(std::thread(ZipTestWorker, &context));
+  ZipTestWorker(&context);
+  for (size_t i = 0; i < workers.size(); ++i)
+    workers[i].join();
+
+  // Entries are left untested only if no worker could open the ZIP file.
+  if (context.next_entry < context.entries.size())
+    return false;
+
+  if (failures != NULL) {
+    std::sort(context.failures.begin(), context.failures.end(), ZipTestFailureLess);
+    ZipTestResolveNames(&context);
+    failures->clear();
+    for (size_t i = 0; i < context.failures.size(); ++i)
+      failures->push_back(context.failures[i].second);
+  }
+
+  return !context.aborted && context.failures.empty();
+}
+
+namespace zlibwrap {
+
+#ifdef _WIN32
+bool ZipTest(const TCHAR *zip_file, std::vector<ZipTestFailure> *failures, unsigned int thread_count) {
+  zlib_filefunc64_def filefunc;
+  ZipFillFileFunc(&filefunc);
+  ZipProgressReporter progress;
+  return ZipTestArchive(zip_file, &filefunc, failures, thread_count, &progress);
+}
+#else
+bool ZipTest(const char *zip_file, std::vector<ZipTestFailure> *failures, unsigned int thread_count) {
+  zlib_filefunc64_def filefunc;
+  ZipFillFileFunc(&filefunc);
+  ZipProgressReporter progress;
+  return ZipTestArchive(zip_file, &filefunc, failures, thread_count, &progress);
+}
+#endif
+
+} // namespace zlibwrap
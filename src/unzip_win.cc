@@ -1,4 +1,5 @@
 #include "encoding.h"
+#include "unzip_reader.h"
 #include "zip.h"
 #include <cstring>
 #include <ctime>
@@ -7,6 +8,7 @@
 #include <minizip/unzip.h>
 #include <string>
 #include <sys/utime.h>
+#include <vector>
 #include <Windows.h>
 #include <zlibwrap/zlibwrap.h>
 // clang-format off
@@ -30,37 +32,133 @@ void mkdirs(TCHAR *path) {
   }
 }
 
-char inner_path_buffer[1024] = {0};
-
-bool ZipExtractCurrentFile(unzFile uf, const tstring &target_dir) {
-  unz_file_info64 file_info;
-  if (unzGetCurrentFileInfo64(uf, &file_info, inner_path_buffer, (uLong)sizeof(inner_path_buffer), NULL, 0, NULL, 0) !=
-      UNZ_OK)
-    return false;
-
-  if (unzOpenCurrentFile(uf) != UNZ_OK)
-    return false;
-  LOKI_ON_BLOCK_EXIT(unzCloseCurrentFile, uf);
-
-  tstring inner_path;
-  if ((file_info.flag & ZIP_GPBF_LANGUAGE_ENCODING_FLAG) != 0) {
+tstring ZipDecodeInnerPath(const char *inner_path, uLong flag) {
+  if ((flag & ZIP_GPBF_LANGUAGE_ENCODING_FLAG) != 0) {
 #ifdef _UNICODE
-    inner_path = encoding::UTF8ToUCS2(inner_path_buffer);
+    return encoding::UTF8ToUCS2(inner_path);
 #else
-    inner_path = encoding::UCS2ToANSI(encoding::UTF8ToUCS2(inner_path_buffer));
+    return encoding::UCS2ToANSI(encoding::UTF8ToUCS2(inner_path));
 #endif
   } else {
 #ifdef _UNICODE
-    inner_path = encoding::ANSIToUCS2(inner_path_buffer);
+    return encoding::ANSIToUCS2(inner_path);
 #else
-    inner_path = inner_path_buffer
+    return inner_path;
 #endif
   }
+}
+
+void ZipDosDateToFileTime(uLong dos_date, FILETIME *ftUTC) {
+  FILETIME ftLocal;
+  DosDateTimeToFileTime((WORD)(dos_date >> 16), (WORD)dos_date, &ftLocal);
+  LocalFileTimeToFileTime(&ftLocal, ftUTC);
+}
+
+void ZipSetFileTime(const tstring &target_path, uLong dos_date, bool is_dir) {
+  HANDLE hFile = CreateFile(target_path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING,
+                            is_dir ? FILE_ATTRIBUTE_DIRECTORY : 0, NULL);
+  if (hFile != INVALID_HANDLE_VALUE) {
+    FILETIME ftUTC;
+    ZipDosDateToFileTime(dos_date, &ftUTC);
+    SetFileTime(hFile, &ftUTC, &ftUTC, &ftUTC);
+    CloseHandle(hFile);
+  }
+}
+
+bool ZipIsFileUnchanged(const tstring &target_path, const unz_file_info64 &file_info, bool compare_crc) {
+  WIN32_FILE_ATTRIBUTE_DATA data = {};
+  if (!GetFileAttributesEx(target_path.c_str(), GetFileExInfoStandard, &data) ||
+      (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0)
+    return false;
+  if ((((ZPOS64_T)data.nFileSizeHigh << 32) | data.nFileSizeLow) != file_info.uncompressed_size)
+    return false;
+  FILETIME ftUTC;
+  ZipDosDateToFileTime(file_info.dosDate, &ftUTC);
+  ULARGE_INTEGER expected_time = {}, actual_time = {};
+  expected_time.LowPart = ftUTC.dwLowDateTime;
+  expected_time.HighPart = ftUTC.dwHighDateTime;
+  actual_time.LowPart = data.ftLastWriteTime.dwLowDateTime;
+  actual_time.HighPart = data.ftLastWriteTime.dwHighDateTime;
+  // FILETIME is in units of 100 nanoseconds.
+  const ULONGLONG TIME_TOLERANCE = 2 * 10000000ULL;
+  if (actual_time.QuadPart + TIME_TOLERANCE <= expected_time.QuadPart ||
+      expected_time.QuadPart + TIME_TOLERANCE <= actual_time.QuadPart)
+    return false;
+  if (!compare_crc)
+    return true;
+
+  FILE *f = _tfopen(target_path.c_str(), _T("rb"));
+  if (f == NULL)
+    return false;
+  LOKI_ON_BLOCK_EXIT(fclose, f);
+
+  const size_t BUFFER_SIZE = 4096;
+  unsigned char buffer[BUFFER_SIZE] = {};
+  uLong crc = crc32(0, NULL, 0);
+  while (!feof(f)) {
+    size_t size = fread(buffer, 1, BUFFER_SIZE, f);
+    if (size < BUFFER_SIZE && ferror(f))
+      return false;
+    crc = crc32(crc, buffer, (uInt)size);
+  }
+  return crc == file_info.crc;
+}
+
+// Rejects paths which would escape the target directory: absolute, with a drive prefix, or with a ".." component.
+// Names must be decoded first, as '\' may be a trail byte in ANSI code pages.
+bool ZipIsSafeInnerPath(const tstring &inner_path) {
+  if (inner_path.empty() || inner_path[0] == _T('/') || inner_path[0] == _T('\\'))
+    return false;
+  if (inner_path.size() >= 2 && _istalpha((_TUCHAR)inner_path[0]) && inner_path[1] == _T(':'))
+    return false;
+  for (size_t begin = 0; begin <= inner_path.size();) {
+    size_t end = inner_path.find_first_of(_T("/\\"), begin);
+    if (end == tstring::npos)
+      end = inner_path.size();
+    if (inner_path.compare(begin, end - begin, _T("..")) == 0)
+      return false;
+    begin = end + 1;
+  }
+  return true;
+}
+
+// inner_path_buffer is reused across entries, and grows only for names longer than any before.
+bool ZipExtractCurrentFile(unzFile uf,
+                           const tstring &target_dir,
+                           std::vector<char> *inner_path_buffer,
+                           unsigned int flags,
+                           zlibwrap::ZipExtractStats *stats,
+                           ZipProgressReporter *progress) {
+  unz_file_info64 file_info;
+  if (unzGetCurrentFileInfo64(uf, &file_info, &(*inner_path_buffer)[0], (uLong)inner_path_buffer->size(), NULL, 0,
+                              NULL, 0) != UNZ_OK)
+    return false;
+  if (file_info.size_filename >= inner_path_buffer->size()) {
+    inner_path_buffer->resize(file_info.size_filename + 1);
+    if (unzGetCurrentFileInfo64(uf, &file_info, &(*inner_path_buffer)[0], (uLong)inner_path_buffer->size(), NULL, 0,
+                                NULL, 0) != UNZ_OK)
+      return false;
+  }
+
+  tstring inner_path = ZipDecodeInnerPath(&(*inner_path_buffer)[0], file_info.flag);
+  if (!ZipIsSafeInnerPath(inner_path))
+    return false;
 
   tstring target_path = target_dir + inner_path;
   mkdirs(&target_path[0]);
   bool is_dir = *inner_path.rbegin() == _T('/');
 
+  if (!is_dir && (flags & zlibwrap::ZIP_EXTRACT_SKIP_UNCHANGED) != 0 &&
+      ZipIsFileUnchanged(target_path, file_info, (flags & zlibwrap::ZIP_EXTRACT_COMPARE_CRC) != 0)) {
+    ++stats->skipped_entries;
+    stats->skipped_bytes += file_info.uncompressed_size;
+    return progress->Report(file_info.uncompressed_size);
+  }
+
+  if (unzOpenCurrentFile(uf) != UNZ_OK)
+    return false;
+  LOKI_ON_BLOCK_EXIT(unzCloseCurrentFile, uf);
+
   if (!is_dir) {
     FILE *f = _tfopen(target_path.c_str(), _T("wb"));
     if (f == NULL)
@@ -75,38 +173,84 @@ bool ZipExtractCurrentFile(unzFile uf, const tstring &target_dir) {
         return false;
       if (size == 0)
         break;
-      if (fwrite(buffer, 1, size, f) != size)
+      if (fwrite(buffer, 1, size, f) != (size_t)size)
+        return false;
+      stats->extracted_bytes += size;
+      if (!progress->Report(size))
         return false;
     }
   }
 
-  HANDLE hFile = CreateFile(target_path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING,
-                            is_dir ? FILE_ATTRIBUTE_DIRECTORY : 0, NULL);
-  if (hFile != INVALID_HANDLE_VALUE) {
-    FILETIME ftLocal, ftUTC;
-    DosDateTimeToFileTime((WORD)(file_info.dosDate >> 16), (WORD)file_info.dosDate, &ftLocal);
-    LocalFileTimeToFileTime(&ftLocal, &ftUTC);
-    SetFileTime(hFile, &ftUTC, &ftUTC, &ftUTC);
-    CloseHandle(hFile);
+  ++stats->extracted_entries;
+  ZipSetFileTime(target_path, file_info.dosDate, is_dir);
+  return true;
+}
+
+bool ZipExtractStreamEntry(ZipStreamReader &reader, const ZipStreamEntry &entry, const tstring &target_dir) {
+  tstring inner_path = ZipDecodeInnerPath(entry.inner_path.c_str(), entry.flag);
+  if (!ZipIsSafeInnerPath(inner_path))
+    return false;
+
+  tstring target_path = target_dir + inner_path;
+  mkdirs(&target_path[0]);
+  bool is_dir = *inner_path.rbegin() == _T('/');
+
+  if (!is_dir) {
+    FILE *f = _tfopen(target_path.c_str(), _T("wb"));
+    if (f == NULL)
+      return false;
+    LOKI_ON_BLOCK_EXIT(fclose, f);
+
+    const size_t BUFFER_SIZE = 4096;
+    unsigned char buffer[BUFFER_SIZE] = {};
+    while (true) {
+      int size = reader.ReadEntry(buffer, BUFFER_SIZE);
+      if (size < 0)
+        return false;
+      if (size == 0)
+        break;
+      if (fwrite(buffer, 1, size, f) != (size_t)size)
+        return false;
+    }
   }
+
+  ZipSetFileTime(target_path, entry.dos_date, is_dir);
   return true;
 }
 
 } // namespace
 
-namespace zlibwrap {
-
-bool ZipExtract(const TCHAR *zip_file, const TCHAR *target_dir) {
-  zlib_filefunc64_def zlib_filefunc_def;
-  fill_win32_filefunc64(&zlib_filefunc_def);
-  unzFile uf = unzOpen2_64(zip_file, &zlib_filefunc_def);
-  if (uf == NULL)
-    return false;
-  LOKI_ON_BLOCK_EXIT(unzClose, uf);
+void ZipFillFileFunc(zlib_filefunc64_def *filefunc) {
+  fill_win32_filefunc64(filefunc);
+}
 
+bool ZipExtractArchive(unzFile uf,
+                       const TCHAR *target_dir,
+                       unsigned int flags,
+                       zlibwrap::ZipExtractStats *stats,
+                       ZipProgressReporter *progress) {
   unz_global_info64 gi = {};
   if (unzGetGlobalInfo64(uf, &gi) != UNZ_OK)
     return false;
+  if (gi.number_entry > 0 && unzGoToFirstFile(uf) != UNZ_OK)
+    return false;
+
+  if (progress->IsEnabled()) {
+    ZPOS64_T total_size = 0;
+    for (ZPOS64_T i = 0; i < gi.number_entry; ++i) {
+      unz_file_info64 file_info = {};
+      if (unzGetCurrentFileInfo64(uf, &file_info, NULL, 0, NULL, 0, NULL, 0) != UNZ_OK)
+        return false;
+      total_size += file_info.uncompressed_size;
+      if (i < gi.number_entry - 1) {
+        if (unzGoToNextFile(uf) != UNZ_OK)
+          return false;
+      }
+    }
+    progress->SetTotalSize(total_size);
+    if (gi.number_entry > 0 && unzGoToFirstFile(uf) != UNZ_OK)
+      return false;
+  }
 
   std::wstring root_dir = target_dir;
   if (!root_dir.empty() && (*root_dir.rbegin() != _T('\\') && *root_dir.rbegin() != _T('/')))
@@ -114,8 +258,9 @@ bool ZipExtract(const TCHAR *zip_file, const TCHAR *target_dir) {
   TCHAR *root_dir_buffer = &root_dir[0];
   mkdirs(root_dir_buffer);
 
-  for (int i = 0; i < gi.number_entry; ++i) {
-    if (!ZipExtractCurrentFile(uf, root_dir))
+  std::vector<char> inner_path_buffer(1024);
+  for (ZPOS64_T i = 0; i < gi.number_entry; ++i) {
+    if (!ZipExtractCurrentFile(uf, root_dir, &inner_path_buffer, flags, stats, progress))
       return false;
     if (i < gi.number_entry - 1) {
       if (unzGoToNextFile(uf) != UNZ_OK)
@@ -126,4 +271,49 @@ bool ZipExtract(const TCHAR *zip_file, const TCHAR *target_dir) {
   return true;
 }
 
+namespace zlibwrap {
+
+bool ZipExtract(const TCHAR *zip_file, const TCHAR *target_dir) {
+  return ZipExtract(zip_file, target_dir, 0, NULL);
+}
+
+bool ZipExtract(const TCHAR *zip_file, const TCHAR *target_dir, unsigned int flags, ZipExtractStats *stats) {
+  zlib_filefunc64_def zlib_filefunc_def;
+  fill_win32_filefunc64(&zlib_filefunc_def);
+  unzFile uf = unzOpen2_64(zip_file, &zlib_filefunc_def);
+  if (uf == NULL)
+    return false;
+  LOKI_ON_BLOCK_EXIT(unzClose, uf);
+
+  ZipExtractStats local_stats = {};
+  ZipProgressReporter progress;
+  bool result = ZipExtractArchive(uf, target_dir, flags, &local_stats, &progress);
+  if (stats != NULL)
+    *stats = local_stats;
+  return result;
+}
+
+bool ZipExtract(ZipSource source, void *context, const TCHAR *target_dir, bool verify_central_directory) {
+  ZipStreamReader reader(source, context, verify_central_directory);
+
+  tstring root_dir = target_dir;
+  if (!root_dir.empty() && (*root_dir.rbegin() != _T('\\') && *root_dir.rbegin() != _T('/')))
+    root_dir += _T("/");
+  TCHAR *root_dir_buffer = &root_dir[0];
+  mkdirs(root_dir_buffer);
+
+  ZipStreamEntry entry;
+  while (true) {
+    int result = reader.NextEntry(&entry);
+    if (result < 0)
+      return false;
+    if (result == 0)
+      break;
+    if (!ZipExtractStreamEntry(reader, entry, root_dir))
+      return false;
+  }
+
+  return !verify_central_directory || reader.VerifyCentralDirectory();
+}
+
 } // namespace zlibwrap
@@ -1,3 +1,198 @@
 #pragma once
 
+#include <minizip/ioapi.h>
+#include <minizip/unzip.h>
+#include <vector>
+#include <zlibwrap/callback.h>
+#include <zlibwrap/zlibwrap.h>
+
+#define ZIP_GPBF_DATA_DESCRIPTOR_FLAG 0x8
 #define ZIP_GPBF_LANGUAGE_ENCODING_FLAG 0x800
+
+#define ZIP_LOCAL_HEADER_SIGNATURE 0x04034b50
+#define ZIP_DATA_DESCRIPTOR_SIGNATURE 0x08074b50
+#define ZIP_CENTRAL_HEADER_SIGNATURE 0x02014b50
+#define ZIP64_END_OF_CENTRAL_DIR_SIGNATURE 0x06064b50
+#define ZIP64_END_OF_CENTRAL_DIR_LOCATOR_SIGNATURE 0x07064b50
+#define ZIP_END_OF_CENTRAL_DIR_SIGNATURE 0x06054b50
+#define ZIP64_EXTRA_FIELD_ID 0x0001
+
+const ZPOS64_T MAX_UINT16 = 0xffff;
+const ZPOS64_T MAX_UINT32 = 0xffffffff;
+
+inline uLong GetUInt16(const unsigned char *p) {
+  return (uLong)p[0] | ((uLong)p[1] << 8);
+}
+
+inline uLong GetUInt32(const unsigned char *p) {
+  return GetUInt16(p) | (GetUInt16(p + 2) << 16);
+}
+
+inline ZPOS64_T GetUInt64(const unsigned char *p) {
+  return (ZPOS64_T)GetUInt32(p) | ((ZPOS64_T)GetUInt32(p + 4) << 32);
+}
+
+/**
+ * @brief Convert a DOS date and time, the same way as minizip does for unz_file_info64::tmu_date.
+ *
+ * @param dos_date DOS date in the high word, DOS time in the low word.
+ * @param tmu_date Receives the date, with a 4-digit year and a 0-based month.
+ */
+inline void DosDateToTmuDate(uLong dos_date, tm_unz *tmu_date) {
+  uLong date = dos_date >> 16;
+  tmu_date->tm_mday = (int)(date & 0x1f);
+  tmu_date->tm_mon = (int)(((date & 0x1e0) / 0x20) - 1);
+  tmu_date->tm_year = (int)(((date & 0x0fe00) / 0x0200) + 1980);
+  tmu_date->tm_hour = (int)((dos_date & 0xf800) / 0x800);
+  tmu_date->tm_min = (int)((dos_date & 0x7e0) / 0x20);
+  tmu_date->tm_sec = (int)(2 * (dos_date & 0x1f));
+}
+
+/**
+ * @brief Replace 32-bit values saturated to 0xffffffff by those in the ZIP64 extra field, in the order of the fields
+ * given.
+ *
+ * @param extra       Extra field data of a local or central header.
+ * @param extra_size  Size of extra field data.
+ * @param fields      Values to replace, in the order they are stored in the ZIP64 extra field.
+ * @param field_count Number of values.
+ * @param found       Optional, receives whether a ZIP64 extra field is present.
+ * @return false if the extra field data is malformed or misses a saturated value.
+ */
+inline bool ParseZip64Extra(const unsigned char *extra,
+                            size_t extra_size,
+                            ZPOS64_T *fields[],
+                            size_t field_count,
+                            bool *found) {
+  if (found != NULL)
+    *found = false;
+  for (size_t pos = 0; pos + 4 <= extra_size;) {
+    uLong id = GetUInt16(extra + pos);
+    size_t size = GetUInt16(extra + pos + 2);
+    pos += 4;
+    if (pos + size > extra_size)
+      return false;
+    if (id == ZIP64_EXTRA_FIELD_ID) {
+      if (found != NULL)
+        *found = true;
+      size_t end = pos + size;
+      for (size_t i = 0; i < field_count; ++i) {
+        if (*fields[i] != MAX_UINT32)
+          continue;
+        if (pos + 8 > end)
+          return false;
+        *fields[i] = GetUInt64(extra + pos);
+        pos += 8;
+      }
+      return true;
+    }
+    pos += size;
+  }
+  return true;
+}
+
+/**
+ * @brief Accumulate bytes processed by an operation, and report them to an optional callback.
+ */
+class ZipProgressReporter {
+public:
+  ZipProgressReporter(ZipProgressCallback callback = NULL, void *context = NULL, unsigned long long total_size = 0)
+      : callback_(callback), context_(context), processed_size_(0), total_size_(total_size) {
+  }
+
+  bool IsEnabled() const {
+    return callback_ != NULL;
+  }
+
+  void SetTotalSize(unsigned long long total_size) {
+    total_size_ = total_size;
+  }
+
+  bool Report(unsigned long long size) {
+    processed_size_ += size;
+    return callback_ == NULL || callback_(context_, processed_size_, total_size_);
+  }
+
+private:
+  ZipProgressCallback callback_;
+  void *context_;
+  unsigned long long processed_size_;
+  unsigned long long total_size_;
+};
+
+/**
+ * @brief A ZIP file in memory, passed as path to file functions filled by ZipFillMemoryFileFunc.
+ */
+struct ZipMemoryFile {
+  const void *data;
+  size_t size;
+};
+
+/**
+ * @brief Fill file functions for opening ZIP files by path on current platform.
+ *
+ * @param filefunc File functions to fill.
+ */
+void ZipFillFileFunc(zlib_filefunc64_def *filefunc);
+
+/**
+ * @brief Fill file functions for reading a ZipMemoryFile in place. Each open has its own position, so the same
+ * ZipMemoryFile can be opened by several threads at a time.
+ *
+ * @param filefunc File functions to fill.
+ */
+void ZipFillMemoryFileFunc(zlib_filefunc64_def *filefunc);
+
+/**
+ * @brief Extract all entries of an opened ZIP file.
+ *
+ * @param uf         Opened ZIP file.
+ * @param target_dir Directory to output files.
+ * @param flags      Combination of zlibwrap::ZipExtractFlags.
+ * @param stats      Receives numbers of entries and bytes extracted and skipped.
+ * @param progress   Receives uncompressed bytes written or skipped.
+ * @return true/false
+ */
+#ifdef _WIN32
+bool ZipExtractArchive(unzFile uf,
+                       const TCHAR *target_dir,
+                       unsigned int flags,
+                       zlibwrap::ZipExtractStats *stats,
+                       ZipProgressReporter *progress);
+#else
+bool ZipExtractArchive(unzFile uf,
+                       const char *target_dir,
+                       unsigned int flags,
+                       zlibwrap::ZipExtractStats *stats,
+                       ZipProgressReporter *progress);
+#endif
+
+/**
+ * @brief Test integrity of a ZIP file, see zlibwrap::ZipTest.
+ *
+ * @param zip_file     Path passed to file functions.
+ * @param filefunc     File functions to open the ZIP file with, once per thread.
+ * @param failures     Optional, receives entries failing the test.
+ * @param thread_count Number of threads, 0 to use the number of CPU cores.
+ * @param progress     Receives uncompressed bytes tested, called by one thread at a time.
+ * @return true/false
+ */
+bool ZipTestArchive(const void *zip_file,
+                    zlib_filefunc64_def *filefunc,
+                    std::vector<zlibwrap::ZipTestFailure> *failures,
+                    unsigned int thread_count,
+                    ZipProgressReporter *progress);
+
+/**
+ * @brief List entries of a ZIP file, see zlibwrap::ZipList.
+ *
+ * @param zip_file Path passed to file functions.
+ * @param filefunc File functions to open the ZIP file with.
+ * @param callback Callback receiving entries.
+ * @param context  Context passed to callback.
+ * @return true/false
+ */
+bool ZipListArchive(const void *zip_file,
+                    zlib_filefunc64_def *filefunc,
+                    zlibwrap::ZipListCallback callback,
+                    void *context);
@@ -0,0 +1,80 @@
+#include "zip.h"
+#include <cstring>
+
+namespace {
+
+struct ZipMemoryStream {
+  const ZipMemoryFile *file;
+  ZPOS64_T position;
+};
+
+voidpf ZCALLBACK ZipMemoryOpen(voidpf opaque, const void *filename, int mode) {
+  if (filename == NULL || (mode & ZLIB_FILEFUNC_MODE_READWRITEFILTER) != ZLIB_FILEFUNC_MODE_READ)
+    return NULL;
+  ZipMemoryStream *stream = new ZipMemoryStream;
+  stream->file = (const ZipMemoryFile *)filename;
+  stream->position = 0;
+  return stream;
+}
+
+uLong ZCALLBACK ZipMemoryRead(voidpf opaque, voidpf stream, void *buf, uLong size) {
+  ZipMemoryStream *s = (ZipMemoryStream *)stream;
+  ZPOS64_T rest_size = s->file->size - s->position;
+  if (size > rest_size)
+    size = (uLong)rest_size;
+  memcpy(buf, (const unsigned char *)s->file->data + s->position, size);
+  s->position += size;
+  return size;
+}
+
+uLong ZCALLBACK ZipMemoryWrite(voidpf opaque, voidpf stream, const void *buf, uLong size) {
+  return 0;
+}
+
+ZPOS64_T ZCALLBACK ZipMemoryTell(voidpf opaque, voidpf stream) {
+  return ((ZipMemoryStream *)stream)->position;
+}
+
+long ZCALLBACK ZipMemorySeek(voidpf opaque, voidpf stream, ZPOS64_T offset, int origin) {
+  ZipMemoryStream *s = (ZipMemoryStream *)stream;
+  ZPOS64_T position = 0;
+  switch (origin) {
+  case ZLIB_FILEFUNC_SEEK_SET:
+    position = offset;
+    break;
+  case ZLIB_FILEFUNC_SEEK_CUR:
+    position = s->position + offset;
+    break;
+  case ZLIB_FILEFUNC_SEEK_END:
+    position = s->file->size + offset;
+    break;
+  default:
+    return -1;
+  }
+  if (position > s->file->size)
+    return -1;
+  s->position = position;
+  return 0;
+}
+
+int ZCALLBACK ZipMemoryClose(voidpf opaque, voidpf stream) {
+  delete (ZipMemoryStream *)stream;
+  return 0;
+}
+
+int ZCALLBACK ZipMemoryError(voidpf opaque, voidpf stream) {
+  return 0;
+}
+
+} // namespace
+
+void ZipFillMemoryFileFunc(zlib_filefunc64_def *filefunc) {
+  filefunc->zopen64_file = ZipMemoryOpen;
+  filefunc->zread_file = ZipMemoryRead;
+  filefunc->zwrite_file = ZipMemoryWrite;
+  filefunc->ztell64_file = ZipMemoryTell;
+  filefunc->zseek64_file = ZipMemorySeek;
+  filefunc->zclose_file = ZipMemoryClose;
+  filefunc->zerror_file = ZipMemoryError;
+  filefunc->opaque = NULL;
+}
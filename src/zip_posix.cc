@@ -1,4 +1,5 @@
 #include "zip.h"
+#include "zip_writer.h"
 #include <ctime>
 #include <glob.h>
 #include <loki/ScopeGuard.h>
@@ -9,7 +10,10 @@
 
 namespace {
 
-bool ZipAddFile(zipFile zf, const std::string &inner_path, const std::string &source_file, const struct stat &st) {
+bool ZipAddFile(ZipWriter *writer,
+                const std::string &inner_path,
+                const std::string &source_file,
+                const struct stat &st) {
 
   zip_fileinfo file_info = {};
   file_info.internal_fa = 0;
@@ -22,11 +26,9 @@ bool ZipAddFile(zipFile zf, const std::string &inner_path, const std::string &so
   file_info.tmz_date.tm_mon = date->tm_mon;
   file_info.tmz_date.tm_year = date->tm_year;
 
-  if (zipOpenNewFileInZip4(zf, inner_path.c_str(), &file_info, NULL, 0, NULL, 0, NULL, Z_DEFLATED, 9, 0, -MAX_WBITS,
-                           DEF_MEM_LEVEL, Z_DEFAULT_STRATEGY, NULL, 0, 0, ZIP_GPBF_LANGUAGE_ENCODING_FLAG) != ZIP_OK) {
+  if (!writer->OpenEntry(inner_path.c_str(), file_info, S_ISDIR(st.st_mode)))
     return false;
-  }
-  LOKI_ON_BLOCK_EXIT(zipCloseFileInZip, zf);
+  LOKI_ON_BLOCK_EXIT_OBJ(*writer, &ZipWriter::CloseEntry);
 
   if (S_ISDIR(st.st_mode))
     return true;
@@ -42,13 +44,13 @@ bool ZipAddFile(zipFile zf, const std::string &inner_path, const std::string &so
     size_t size = fread(buffer, 1, BUFFER_SIZE, f);
     if (size < BUFFER_SIZE && ferror(f))
       return false;
-    if (zipWriteInFileInZip(zf, buffer, (unsigned int)size) < 0)
+    if (!writer->WriteEntry(buffer, size))
       return false;
   }
   return true;
 }
 
-bool ZipAddFiles(zipFile zf, const std::string &inner_dir, const std::string &pattern) {
+bool ZipAddFiles(ZipWriter *writer, const std::string &inner_dir, const std::string &pattern) {
   glob_t globbuf = {};
   if (glob(pattern.c_str(), 0, NULL, &globbuf) != 0)
     return false;
@@ -68,12 +70,12 @@ bool ZipAddFiles(zipFile zf, const std::string &inner_dir, const std::string &pa
       return false;
     if (S_ISDIR(st.st_mode)) {
       inner_path += "/";
-      if (!ZipAddFile(zf, inner_path, source_path, st))
+      if (!ZipAddFile(writer, inner_path, source_path, st))
         return false;
-      if (!ZipAddFiles(zf, inner_path, source_path + "/*"))
+      if (!ZipAddFiles(writer, inner_path, source_path + "/*"))
         return false;
     } else {
-      if (!ZipAddFile(zf, inner_path, source_path, st))
+      if (!ZipAddFile(writer, inner_path, source_path, st))
         return false;
     }
   }
@@ -82,6 +84,10 @@ bool ZipAddFiles(zipFile zf, const std::string &inner_dir, const std::string &pa
 
 } // namespace
 
+bool ZipWriteFiles(ZipWriter *writer, const char *pattern) {
+  return ZipAddFiles(writer, "", pattern);
+}
+
 namespace zlibwrap {
 
 bool ZipCompress(const char *zip_file, const char *pattern) {
@@ -90,7 +96,15 @@ bool ZipCompress(const char *zip_file, const char *pattern) {
     return false;
   LOKI_ON_BLOCK_EXIT(zipClose, zf, (const char *)NULL);
 
-  return ZipAddFiles(zf, "", pattern);
+  ZipFileWriter writer(zf);
+  return ZipWriteFiles(&writer, pattern);
+}
+
+bool ZipCompress(ZipSink sink, void *context, const char *pattern) {
+  ZipStreamWriter writer(sink, context);
+  if (!ZipWriteFiles(&writer, pattern))
+    return false;
+  return writer.Close();
 }
 
 } // namespace zlibwrap
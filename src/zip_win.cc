@@ -1,5 +1,6 @@
 #include "encoding.h"
 #include "zip.h"
+#include "zip_writer.h"
 #include <ctime>
 #include <io.h>
 #include <loki/ScopeGuard.h>
@@ -19,7 +20,10 @@ typedef std::wstring tstring;
 typedef std::string tstring;
 #endif
 
-bool ZipAddFile(zipFile zf, const tstring &inner_path, const tstring &source_file, const _wfinddata64_t &find_data) {
+bool ZipAddFile(ZipWriter *writer,
+                const tstring &inner_path,
+                const tstring &source_file,
+                const _wfinddata64_t &find_data) {
   zip_fileinfo file_info = {};
   file_info.internal_fa = 0;
   file_info.external_fa = find_data.attrib;
@@ -40,12 +44,9 @@ bool ZipAddFile(zipFile zf, const tstring &inner_path, const tstring &source_fil
 #else
   const std::string inner_path_utf8 = encoding::UCS2ToUTF8(encoding::ANSIToUCS2(inner_path));
 #endif
-  if (zipOpenNewFileInZip4(zf, inner_path_utf8.c_str(), &file_info, NULL, 0, NULL, 0, NULL, Z_DEFLATED, 9, 0,
-                           -MAX_WBITS, DEF_MEM_LEVEL, Z_DEFAULT_STRATEGY, NULL, 0, 0,
-                           ZIP_GPBF_LANGUAGE_ENCODING_FLAG) != ZIP_OK) {
+  if (!writer->OpenEntry(inner_path_utf8.c_str(), file_info, (find_data.attrib & _A_SUBDIR) != 0))
     return false;
-  }
-  LOKI_ON_BLOCK_EXIT(zipCloseFileInZip, zf);
+  LOKI_ON_BLOCK_EXIT_OBJ(*writer, &ZipWriter::CloseEntry);
 
   if ((find_data.attrib & _A_SUBDIR) != 0)
     return true;
@@ -61,13 +62,13 @@ bool ZipAddFile(zipFile zf, const tstring &inner_path, const tstring &source_fil
     size_t size = fread(buffer, 1, BUFFER_SIZE, f);
     if (size < BUFFER_SIZE && ferror(f))
       return false;
-    if (zipWriteInFileInZip(zf, buffer, (unsigned int)size) < 0)
+    if (!writer->WriteEntry(buffer, size))
       return false;
   }
   return true;
 }
 
-bool ZipAddFiles(zipFile zf, const tstring &inner_dir, const tstring &pattern) {
+bool ZipAddFiles(ZipWriter *writer, const tstring &inner_dir, const tstring &pattern) {
   size_t slash = pattern.rfind(_T('/'));
   size_t back_slash = pattern.rfind(_T('\\'));
   size_t slash_pos = slash != tstring::npos && back_slash != tstring::npos
@@ -91,12 +92,12 @@ bool ZipAddFiles(zipFile zf, const tstring &inner_dir, const tstring &pattern) {
     tstring source_path = source_dir + find_data.name;
     if ((find_data.attrib & _A_SUBDIR) != 0) {
       inner_path += _T("/");
-      if (!ZipAddFile(zf, inner_path, source_path, find_data))
+      if (!ZipAddFile(writer, inner_path, source_path, find_data))
         return false;
-      if (!ZipAddFiles(zf, inner_path, source_path + _T("/*")))
+      if (!ZipAddFiles(writer, inner_path, source_path + _T("/*")))
         return false;
     } else {
-      if (!ZipAddFile(zf, inner_path, source_path, find_data))
+      if (!ZipAddFile(writer, inner_path, source_path, find_data))
         return false;
     }
   } while (_wfindnext64(find, &find_data) == 0);
@@ -106,6 +107,10 @@ bool ZipAddFiles(zipFile zf, const tstring &inner_dir, const tstring &pattern) {
 
 } // namespace
 
+bool ZipWriteFiles(ZipWriter *writer, const TCHAR *pattern) {
+  return ZipAddFiles(writer, _T(""), pattern);
+}
+
 namespace zlibwrap {
 
 bool ZipCompress(const TCHAR *zip_file, const TCHAR *pattern) {
@@ -116,7 +121,15 @@ bool ZipCompress(const TCHAR *zip_file, const TCHAR *pattern) {
     return false;
   LOKI_ON_BLOCK_EXIT(zipClose, zf, (const char *)NULL);
 
-  return ZipAddFiles(zf, _T(""), pattern);
+  ZipFileWriter writer(zf);
+  return ZipWriteFiles(&writer, pattern);
+}
+
+bool ZipCompress(ZipSink sink, void *context, const TCHAR *pattern) {
+  ZipStreamWriter writer(sink, context);
+  if (!ZipWriteFiles(&writer, pattern))
+    return false;
+  return writer.Close();
 }
 
 } // namespace zlibwrap
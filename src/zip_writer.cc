@@ -0,0 +1,315 @@
+#include "zip_writer.h"
+#include "zip.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const size_t BUFFER_SIZE = 64 * 1024;
+
+void PutUInt16(std::string &s, ZPOS64_T value) {
+  for (int i = 0; i < 2; ++i, value >>= 8)
+    s += (char)(value & 0xff);
+}
+
+void PutUInt32(std::string &s, ZPOS64_T value) {
+  for (int i = 0; i < 4; ++i, value >>= 8)
+    s += (char)(value & 0xff);
+}
+
+void PutUInt64(std::string &s, ZPOS64_T value) {
+  for (int i = 0; i < 8; ++i, value >>= 8)
+    s += (char)(value & 0xff);
+}
+
+// Same conversion as minizip does when zip_fileinfo::dosDate is 0.
+uLong TmzDateToDosDate(const tm_zip &date) {
+  uLong year = (uLong)date.tm_year;
+  if (year >= 1980)
+    year -= 1980;
+  else if (year >= 80)
+    year -= 80;
+  return (uLong)(((date.tm_mday) + (32 * (date.tm_mon + 1)) + (512 * year)) << 16) |
+         ((date.tm_sec / 2) + (32 * date.tm_min) + (2048 * (uLong)date.tm_hour));
+}
+
+} // namespace
+
+ZipFileWriter::ZipFileWriter(zipFile zf) : zf_(zf), failed_(false) {
+}
+
+bool ZipFileWriter::OpenEntry(const char *inner_path, const zip_fileinfo &file_info, bool is_dir) {
+  if (failed_)
+    return false;
+  return zipOpenNewFileInZip4(zf_, inner_path, &file_info, NULL, 0, NULL, 0, NULL, Z_DEFLATED, level_, 0, -MAX_WBITS,
+                              DEF_MEM_LEVEL, Z_DEFAULT_STRATEGY, NULL, 0, 0, ZIP_GPBF_LANGUAGE_ENCODING_FLAG) == ZIP_OK;
+}
+
+bool ZipFileWriter::WriteEntry(const void *data, size_t size) {
+  const unsigned char *p = (const unsigned char *)data;
+  while (size > 0) {
+    unsigned int chunk_size = (unsigned int)std::min<size_t>(size, 1 << 30);
+    if (zipWriteInFileInZip(zf_, p, chunk_size) < 0 || !progress_.Report(chunk_size)) {
+      failed_ = true;
+      return false;
+    }
+    p += chunk_size;
+    size -= chunk_size;
+  }
+  return true;
+}
+
+bool ZipFileWriter::CloseEntry() {
+  return zipCloseFileInZip(zf_) == ZIP_OK && !failed_;
+}
+
+ZipStreamWriter::ZipStreamWriter(zlibwrap::ZipSink sink, void *context)
+    : sink_(sink), context_(context), buffer_(BUFFER_SIZE), buffer_size_(0), offset_(0), stream_(),
+      stream_initialized_(false), stream_level_(0), entry_opened_(false), failed_(false) {
+}
+
+ZipStreamWriter::~ZipStreamWriter() {
+  if (stream_initialized_)
+    deflateEnd(&stream_);
+}
+
+bool ZipStreamWriter::OpenEntry(const char *inner_path, const zip_fileinfo &file_info, bool is_dir) {
+  if (failed_ || entry_opened_)
+    return false;
+  size_t inner_path_length = strlen(inner_path);
+  if (inner_path_length > MAX_UINT16)
+    return false;
+
+  Entry entry = {};
+  entry.inner_path = inner_path;
+  // Directories have no data, so their sizes are known up front.
+  entry.flag = ZIP_GPBF_LANGUAGE_ENCODING_FLAG | (is_dir ? 0 : ZIP_GPBF_DATA_DESCRIPTOR_FLAG);
+  entry.method = is_dir ? 0 : Z_DEFLATED;
+  entry.dos_date = file_info.dosDate != 0 ? file_info.dosDate : TmzDateToDosDate(file_info.tmz_date);
+  entry.offset = offset_;
+  entry.external_fa = file_info.external_fa;
+
+  if (!is_dir) {
+    if (stream_initialized_ && stream_level_ != level_) {
+      deflateEnd(&stream_);
+      stream_initialized_ = false;
+    }
+    int result = stream_initialized_ ? deflateReset(&stream_)
+                                     : deflateInit2(&stream_, level_, Z_DEFLATED, -MAX_WBITS, DEF_MEM_LEVEL,
+                                                    Z_DEFAULT_STRATEGY);
+    if (result != Z_OK) {
+      failed_ = true;
+      return false;
+    }
+    stream_initialized_ = true;
+    stream_level_ = level_;
+  }
+
+  // Sizes are unknown until the entry is finished, so files always carry a ZIP64 extra field, which announces 8-byte
+  // sizes in the data descriptor (APPNOTE 4.3.9).
+  std::string zip64_extra;
+  if (!is_dir) {
+    PutUInt16(zip64_extra, ZIP64_EXTRA_FIELD_ID);
+    PutUInt16(zip64_extra, 16);
+    PutUInt64(zip64_extra, 0);
+    PutUInt64(zip64_extra, 0);
+  }
+
+  std::string header;
+  PutUInt32(header, ZIP_LOCAL_HEADER_SIGNATURE);
+  PutUInt16(header, is_dir ? 20 : 45);
+  PutUInt16(header, entry.flag);
+  PutUInt16(header, entry.method);
+  PutUInt32(header, entry.dos_date);
+  PutUInt32(header, 0);
+  PutUInt32(header, is_dir ? 0 : MAX_UINT32);
+  PutUInt32(header, is_dir ? 0 : MAX_UINT32);
+  PutUInt16(header, inner_path_length);
+  PutUInt16(header, zip64_extra.length());
+  header.append(inner_path, inner_path_length);
+  header += zip64_extra;
+
+  entries_.push_back(entry);
+  entry_opened_ = true;
+  return Write(header.data(), header.size());
+}
+
+bool ZipStreamWriter::WriteEntry(const void *data, size_t size) {
+  if (failed_ || !entry_opened_)
+    return false;
+  Entry &entry = entries_.back();
+  if (entry.method != Z_DEFLATED)
+    return size == 0;
+
+  const Bytef *p = (const Bytef *)data;
+  while (size > 0) {
+    uInt chunk_size = (uInt)std::min<size_t>(size, 1 << 30);
+    entry.crc = crc32(entry.crc, p, chunk_size);
+    entry.uncompressed_size += chunk_size;
+    stream_.next_in = (Bytef *)p;
+    stream_.avail_in = chunk_size;
+    if (!Deflate(Z_NO_FLUSH))
+      return false;
+    if (!progress_.Report(chunk_size)) {
+      failed_ = true;
+      return false;
+    }
+    p += chunk_size;
+    size -= chunk_size;
+  }
+  return true;
+}
+
+bool ZipStreamWriter::CloseEntry() {
+  if (!entry_opened_)
+    return false;
+  entry_opened_ = false;
+  const Entry &entry = entries_.back();
+  if (entry.method != Z_DEFLATED)
+    return !failed_;
+
+  stream_.next_in = NULL;
+  stream_.avail_in = 0;
+  if (failed_ || !Deflate(Z_FINISH))
+    return false;
+
+  // Sizes are 8 bytes, as announced by the ZIP64 extra field of the local header.
+  std::string descriptor;
+  PutUInt32(descriptor, ZIP_DATA_DESCRIPTOR_SIGNATURE);
+  PutUInt32(descriptor, entry.crc);
+  PutUInt64(descriptor, entry.compressed_size);
+  PutUInt64(descriptor, entry.uncompressed_size);
+  return Write(descriptor.data(), descriptor.size());
+}
+
+bool ZipStreamWriter::Close() {
+  if (entry_opened_)
+    CloseEntry();
+  if (failed_)
+    return false;
+
+  ZPOS64_T central_dir_offset = offset_;
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    const Entry &entry = entries_[i];
+    std::string zip64_extra;
+    if (entry.uncompressed_size >= MAX_UINT32)
+      PutUInt64(zip64_extra, entry.uncompressed_size);
+    if (entry.compressed_size >= MAX_UINT32)
+      PutUInt64(zip64_extra, entry.compressed_size);
+    if (entry.offset >= MAX_UINT32)
+      PutUInt64(zip64_extra, entry.offset);
+
+    std::string header;
+    PutUInt32(header, ZIP_CENTRAL_HEADER_SIGNATURE);
+    PutUInt16(header, 0);
+    PutUInt16(header, zip64_extra.empty() && (entry.flag & ZIP_GPBF_DATA_DESCRIPTOR_FLAG) == 0 ? 20 : 45);
+    PutUInt16(header, entry.flag);
+    PutUInt16(header, entry.method);
+    PutUInt32(header, entry.dos_date);
+    PutUInt32(header, entry.crc);
+    PutUInt32(header, std::min(entry.compressed_size, MAX_UINT32));
+    PutUInt32(header, std::min(entry.uncompressed_size, MAX_UINT32));
+    PutUInt16(header, entry.inner_path.length());
+    PutUInt16(header, zip64_extra.empty() ? 0 : 4 + zip64_extra.length());
+    PutUInt16(header, 0);
+    PutUInt16(header, 0);
+    PutUInt16(header, 0);
+    PutUInt32(header, entry.external_fa);
+    PutUInt32(header, std::min(entry.offset, MAX_UINT32));
+    header += entry.inner_path;
+    if (!zip64_extra.empty()) {
+      PutUInt16(header, ZIP64_EXTRA_FIELD_ID);
+      PutUInt16(header, zip64_extra.length());
+      header += zip64_extra;
+    }
+    if (!Write(header.data(), header.size()))
+      return false;
+  }
+  ZPOS64_T central_dir_size = offset_ - central_dir_offset;
+
+  std::string end;
+  ZPOS64_T entry_count = entries_.size();
+  if (entry_count >= MAX_UINT16 || central_dir_size >= MAX_UINT32 || central_dir_offset >= MAX_UINT32) {
+    ZPOS64_T zip64_end_offset = offset_;
+    PutUInt32(end, ZIP64_END_OF_CENTRAL_DIR_SIGNATURE);
+    PutUInt64(end, 44);
+    PutUInt16(end, 45);
+    PutUInt16(end, 45);
+    PutUInt32(end, 0);
+    PutUInt32(end, 0);
+    PutUInt64(end, entry_count);
+    PutUInt64(end, entry_count);
+    PutUInt64(end, central_dir_size);
+    PutUInt64(end, central_dir_offset);
+    PutUInt32(end, ZIP64_END_OF_CENTRAL_DIR_LOCATOR_SIGNATURE);
+    PutUInt32(end, 0);
+    PutUInt64(end, zip64_end_offset);
+    PutUInt32(end, 1);
+  }
+  PutUInt32(end, ZIP_END_OF_CENTRAL_DIR_SIGNATURE);
+  PutUInt16(end, 0);
+  PutUInt16(end, 0);
+  PutUInt16(end, std::min(entry_count, MAX_UINT16));
+  PutUInt16(end, std::min(entry_count, MAX_UINT16));
+  PutUInt32(end, std::min(central_dir_size, MAX_UINT32));
+  PutUInt32(end, std::min(central_dir_offset, MAX_UINT32));
+  PutUInt16(end, 0);
+  if (!Write(end.data(), end.size()))
+    return false;
+
+  return Flush();
+}
+
+bool ZipStreamWriter::Write(const void *data, size_t size) {
+  const unsigned char *p = (const unsigned char *)data;
+  while (size > 0) {
+    size_t copy_size = std::min(size, buffer_.size() - buffer_size_);
+    memcpy(&buffer_[buffer_size_], p, copy_size);
+    buffer_size_ += copy_size;
+    offset_ += copy_size;
+    p += copy_size;
+    size -= copy_size;
+    if (buffer_size_ == buffer_.size() && !Flush())
+      return false;
+  }
+  return true;
+}
+
+bool ZipStreamWriter::Deflate(int flush) {
+  Entry &entry = entries_.back();
+  while (true) {
+    stream_.next_out = &buffer_[buffer_size_];
+    stream_.avail_out = (uInt)(buffer_.size() - buffer_size_);
+    int result = deflate(&stream_, flush);
+    if (result == Z_STREAM_ERROR) {
+      failed_ = true;
+      return false;
+    }
+    size_t size = buffer_.size() - buffer_size_ - stream_.avail_out;
+    buffer_size_ += size;
+    offset_ += size;
+    entry.compressed_size += size;
+    if (result == Z_STREAM_END)
+      return true;
+    // deflate stops either when input is consumed or when output is full.
+    if (stream_.avail_out != 0) {
+      if (flush != Z_FINISH)
+        return true;
+      failed_ = true;
+      return false;
+    }
+    if (!Flush())
+      return false;
+  }
+}
+
+bool ZipStreamWriter::Flush() {
+  if (failed_)
+    return false;
+  if (buffer_size_ > 0 && !sink_(context_, &buffer_[0], buffer_size_)) {
+    failed_ = true;
+    return false;
+  }
+  buffer_size_ = 0;
+  return true;
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "zip.h"
+#include <minizip/zip.h>
+#include <string>
+#include <vector>
+#include <zlibwrap/zlibwrap.h>
+
+/**
+ * @brief Destination of entries added to a ZIP file.
+ */
+class ZipWriter {
+public:
+  ZipWriter() : level_(Z_BEST_COMPRESSION) {
+  }
+  virtual ~ZipWriter() {
+  }
+
+  /**
+   * @brief Set compression level of entries opened afterwards.
+   *
+   * @param level Compression level, from 0 (no compression) to 9 (best compression).
+   */
+  void SetLevel(int level) {
+    level_ = level;
+  }
+
+  /**
+   * @brief Set callback receiving uncompressed bytes written. Total size is always 0, as it is unknown.
+   *
+   * @param callback Progress callback, NULL to disable.
+   * @param context  Context passed to callback.
+   */
+  void SetProgressCallback(ZipProgressCallback callback, void *context) {
+    progress_ = ZipProgressReporter(callback, context);
+  }
+
+  /**
+   * @brief Begin a new entry.
+   *
+   * @param inner_path Entry path in UTF-8, ending with '/' for directories.
+   * @param file_info  Time and attributes of the entry.
+   * @param is_dir     Whether the entry is a directory.
+   * @return true/false
+   */
+  virtual bool OpenEntry(const char *inner_path, const zip_fileinfo &file_info, bool is_dir) = 0;
+
+  /**
+   * @brief Append data to the current entry.
+   *
+   * @param data Data to append.
+   * @param size Size of data in bytes.
+   * @return true/false
+   */
+  virtual bool WriteEntry(const void *data, size_t size) = 0;
+
+  /**
+   * @brief Finish the current entry.
+   *
+   * @return true/false
+   */
+  virtual bool CloseEntry() = 0;
+
+protected:
+  int level_;
+  ZipProgressReporter progress_;
+};
+
+/**
+ * @brief Writes entries to a seekable ZIP file opened by minizip.
+ */
+class ZipFileWriter : public ZipWriter {
+public:
+  explicit ZipFileWriter(zipFile zf);
+
+  bool OpenEntry(const char *inner_path, const zip_fileinfo &file_info, bool is_dir) override;
+  bool WriteEntry(const void *data, size_t size) override;
+  bool CloseEntry() override;
+
+  /**
+   * @brief Whether writing an entry failed or was aborted by the progress callback.
+   *
+   * @return true/false
+   */
+  bool IsFailed() const {
+    return failed_;
+  }
+
+private:
+  zipFile zf_;
+  bool failed_;
+};
+
+/**
+ * @brief Writes entries to a sink in a single forward pass, never seeking back.
+ *
+ * Entries are deflated with general purpose bit 3 set, so their CRC32 and sizes follow the data in data descriptors
+ * instead of being patched into local headers. Local headers of files carry a ZIP64 extra field, so sizes in data
+ * descriptors are always 8 bytes. Only central directory records are kept in memory until Close().
+ */
+class ZipStreamWriter : public ZipWriter {
+public:
+  ZipStreamWriter(zlibwrap::ZipSink sink, void *context);
+  ~ZipStreamWriter();
+
+  bool OpenEntry(const char *inner_path, const zip_fileinfo &file_info, bool is_dir) override;
+  bool WriteEntry(const void *data, size_t size) override;
+  bool CloseEntry() override;
+
+  /**
+   * @brief Write the central directory and flush everything to the sink.
+   *
+   * @return true if all entries and the central directory were written successfully.
+   */
+  bool Close();
+
+private:
+  ZipStreamWriter(const ZipStreamWriter &) = delete;
+  ZipStreamWriter &operator=(const ZipStreamWriter &) = delete;
+
+  struct Entry {
+    std::string inner_path;
+    uLong flag;
+    uLong method;
+    uLong dos_date;
+    uLong crc;
+    ZPOS64_T compressed_size;
+    ZPOS64_T uncompressed_size;
+    ZPOS64_T offset;
+    uLong external_fa;
+  };
+
+  bool Write(const void *data, size_t size);
+  bool Deflate(int flush);
+  bool Flush();
+
+  zlibwrap::ZipSink sink_;
+  void *context_;
+  std::vector<unsigned char> buffer_;
+  size_t buffer_size_;
+  ZPOS64_T offset_;
+  std::vector<Entry> entries_;
+  z_stream stream_;
+  bool stream_initialized_;
+  int stream_level_;
+  bool entry_opened_;
+  bool failed_;
+};
+
+/**
+ * @brief Add files to a ZIP file.
+ *
+ * @param writer  Destination of entries.
+ * @param pattern Source files, supporting wildcards.
+ * @return true/false
+ */
+#ifdef _WIN32
+bool ZipWriteFiles(ZipWriter *writer, const TCHAR *pattern);
+#else
+bool ZipWriteFiles(ZipWriter *writer, const char *pattern);
+#endif
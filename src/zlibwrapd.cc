@@ -1,3 +1,13 @@
+#include "zip.h"
+#include "zip_writer.h"
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <loki/ScopeGuard.h>
+#include <memory>
+#include <minizip/unzip.h>
+#include <minizip/zip.h>
+#include <string>
 #include <zlibwrap/zlibwrap.h>
 #include <zlibwrap/zlibwrapd.h>
 
@@ -20,3 +30,283 @@ ZLIBWRAP_API bool ZipExtract(const char *zip_file, const char *target_dir) {
 }
 
 #endif
+
+struct ZipWriterObject {
+  zipFile zf;
+  std::unique_ptr<ZipFileWriter> file_writer;
+  std::unique_ptr<ZipStreamWriter> stream_writer;
+  ZipWriter *writer;
+};
+
+struct ZipReaderObject {
+#ifdef _UNICODE
+  std::wstring zip_file;
+#else
+  std::string zip_file;
+#endif
+  ZipMemoryFile memory_file;
+  const void *opened_file;
+  zlib_filefunc64_def filefunc;
+  unzFile uf;
+  unsigned int thread_count;
+  ZipProgressCallback progress_callback;
+  void *progress_context;
+};
+
+namespace {
+
+ZipReaderHandle ZipReaderOpenObject(ZipReaderObject *reader) {
+  reader->uf = unzOpen2_64(reader->opened_file, &reader->filefunc);
+  if (reader->uf == NULL) {
+    delete reader;
+    return NULL;
+  }
+  return reader;
+}
+
+// Inflate straight into the caller buffer. minizip stops at the size declared by the central directory, and reports
+// corrupted data as UNZ_CRCERROR when the entry is closed.
+bool ZipReadCurrentFile(unzFile uf, void *buffer, size_t size, ZipProgressReporter *progress) {
+  unsigned char *p = (unsigned char *)buffer;
+  size_t read_size = 0;
+  while (read_size < size) {
+    unsigned int chunk_size = (unsigned int)std::min<size_t>(size - read_size, 1 << 30);
+    int result = unzReadCurrentFile(uf, p + read_size, chunk_size);
+    if (result <= 0)
+      return false;
+    read_size += result;
+    if (!progress->Report(result))
+      return false;
+  }
+  return true;
+}
+
+} // namespace
+
+#ifdef _WIN32
+ZLIBWRAP_API ZipWriterHandle ZipWriterOpen(const TCHAR *zip_file) {
+#else
+ZLIBWRAP_API ZipWriterHandle ZipWriterOpen(const char *zip_file) {
+#endif
+  zlib_filefunc64_def filefunc;
+  ZipFillFileFunc(&filefunc);
+  zipFile zf = zipOpen2_64(zip_file, 0, NULL, &filefunc);
+  if (zf == NULL)
+    return NULL;
+
+  ZipWriterObject *writer = new ZipWriterObject;
+  writer->zf = zf;
+  writer->file_writer.reset(new ZipFileWriter(zf));
+  writer->writer = writer->file_writer.get();
+  return writer;
+}
+
+ZLIBWRAP_API ZipWriterHandle ZipWriterOpenCallback(ZipSinkCallback callback, void *context) {
+  if (callback == NULL)
+    return NULL;
+
+  ZipWriterObject *writer = new ZipWriterObject;
+  writer->zf = NULL;
+  writer->stream_writer.reset(new ZipStreamWriter(callback, context));
+  writer->writer = writer->stream_writer.get();
+  return writer;
+}
+
+ZLIBWRAP_API bool ZipWriterSetLevel(ZipWriterHandle writer, int level) {
+  if (writer == NULL || level < Z_NO_COMPRESSION || level > Z_BEST_COMPRESSION)
+    return false;
+  writer->writer->SetLevel(level);
+  return true;
+}
+
+ZLIBWRAP_API bool ZipWriterSetProgressCallback(ZipWriterHandle writer, ZipProgressCallback callback, void *context) {
+  if (writer == NULL)
+    return false;
+  writer->writer->SetProgressCallback(callback, context);
+  return true;
+}
+
+#ifdef _WIN32
+ZLIBWRAP_API bool ZipWriterAddFiles(ZipWriterHandle writer, const TCHAR *pattern) {
+#else
+ZLIBWRAP_API bool ZipWriterAddFiles(ZipWriterHandle writer, const char *pattern) {
+#endif
+  if (writer == NULL || pattern == NULL)
+    return false;
+  return ZipWriteFiles(writer->writer, pattern);
+}
+
+ZLIBWRAP_API bool ZipWriterAddMemory(ZipWriterHandle writer, const char *inner_path, const void *data, size_t size) {
+  if (writer == NULL || inner_path == NULL || *inner_path == '\0' || (data == NULL && size > 0))
+    return false;
+  bool is_dir = inner_path[strlen(inner_path) - 1] == '/';
+
+  zip_fileinfo file_info = {};
+  time_t now = time(NULL);
+  tm *date = localtime(&now);
+  file_info.tmz_date.tm_sec = date->tm_sec;
+  file_info.tmz_date.tm_min = date->tm_min;
+  file_info.tmz_date.tm_hour = date->tm_hour;
+  file_info.tmz_date.tm_mday = date->tm_mday;
+  file_info.tmz_date.tm_mon = date->tm_mon;
+  file_info.tmz_date.tm_year = date->tm_year;
+
+  if (!writer->writer->OpenEntry(inner_path, file_info, is_dir))
+    return false;
+  LOKI_ON_BLOCK_EXIT_OBJ(*writer->writer, &ZipWriter::CloseEntry);
+
+  return is_dir || writer->writer->WriteEntry(data, size);
+}
+
+ZLIBWRAP_API bool ZipWriterClose(ZipWriterHandle writer) {
+  if (writer == NULL)
+    return false;
+  std::unique_ptr<ZipWriterObject> object(writer);
+
+  if (writer->stream_writer)
+    return writer->stream_writer->Close();
+  bool closed = zipClose(writer->zf, NULL) == ZIP_OK;
+  return closed && !writer->file_writer->IsFailed();
+}
+
+#ifdef _WIN32
+ZLIBWRAP_API ZipReaderHandle ZipReaderOpen(const TCHAR *zip_file) {
+#else
+ZLIBWRAP_API ZipReaderHandle ZipReaderOpen(const char *zip_file) {
+#endif
+  if (zip_file == NULL)
+    return NULL;
+
+  ZipReaderObject *reader = new ZipReaderObject();
+  reader->zip_file = zip_file;
+  reader->opened_file = reader->zip_file.c_str();
+  ZipFillFileFunc(&reader->filefunc);
+  return ZipReaderOpenObject(reader);
+}
+
+ZLIBWRAP_API ZipReaderHandle ZipReaderOpenMemory(const void *data, size_t size) {
+  if (data == NULL)
+    return NULL;
+
+  ZipReaderObject *reader = new ZipReaderObject();
+  reader->memory_file.data = data;
+  reader->memory_file.size = size;
+  reader->opened_file = &reader->memory_file;
+  ZipFillMemoryFileFunc(&reader->filefunc);
+  return ZipReaderOpenObject(reader);
+}
+
+ZLIBWRAP_API bool ZipReaderSetThreadCount(ZipReaderHandle reader, unsigned int thread_count) {
+  if (reader == NULL)
+    return false;
+  reader->thread_count = thread_count;
+  return true;
+}
+
+ZLIBWRAP_API bool ZipReaderSetProgressCallback(ZipReaderHandle reader, ZipProgressCallback callback, void *context) {
+  if (reader == NULL)
+    return false;
+  reader->progress_callback = callback;
+  reader->progress_context = context;
+  return true;
+}
+
+ZLIBWRAP_API bool ZipReaderGetEntryCount(ZipReaderHandle reader, unsigned long long *count) {
+  if (reader == NULL || count == NULL)
+    return false;
+  unz_global_info64 gi = {};
+  if (unzGetGlobalInfo64(reader->uf, &gi) != UNZ_OK)
+    return false;
+  *count = gi.number_entry;
+  return true;
+}
+
+ZLIBWRAP_API bool ZipReaderGetEntrySize(ZipReaderHandle reader, const char *inner_path, unsigned long long *size) {
+  if (reader == NULL || inner_path == NULL || size == NULL)
+    return false;
+  if (unzLocateFile(reader->uf, inner_path, 1) != UNZ_OK)
+    return false;
+  unz_file_info64 file_info = {};
+  if (unzGetCurrentFileInfo64(reader->uf, &file_info, NULL, 0, NULL, 0, NULL, 0) != UNZ_OK)
+    return false;
+  *size = file_info.uncompressed_size;
+  return true;
+}
+
+ZLIBWRAP_API bool ZipReaderExtractToBuffer(ZipReaderHandle reader,
+                                           const char *inner_path,
+                                           void *buffer,
+                                           size_t buffer_size,
+                                           size_t *size) {
+  if (reader == NULL || inner_path == NULL || size == NULL || (buffer == NULL && buffer_size > 0))
+    return false;
+  if (unzLocateFile(reader->uf, inner_path, 1) != UNZ_OK)
+    return false;
+  unz_file_info64 file_info = {};
+  if (unzGetCurrentFileInfo64(reader->uf, &file_info, NULL, 0, NULL, 0, NULL, 0) != UNZ_OK)
+    return false;
+  if (file_info.uncompressed_size > (size_t)-1)
+    return false;
+  *size = (size_t)file_info.uncompressed_size;
+  if (*size > buffer_size)
+    return false;
+
+  if (unzOpenCurrentFile(reader->uf) != UNZ_OK)
+    return false;
+  ZipProgressReporter progress(reader->progress_callback, reader->progress_context, *size);
+  bool read = ZipReadCurrentFile(reader->uf, buffer, *size, &progress);
+  // Closing checks CRC32 of what was read.
+  return unzCloseCurrentFile(reader->uf) == UNZ_OK && read;
+}
+
+#ifdef _WIN32
+ZLIBWRAP_API bool ZipReaderExtract(ZipReaderHandle reader, const TCHAR *target_dir) {
+#else
+ZLIBWRAP_API bool ZipReaderExtract(ZipReaderHandle reader, const char *target_dir) {
+#endif
+  if (reader == NULL || target_dir == NULL)
+    return false;
+  zlibwrap::ZipExtractStats stats = {};
+  ZipProgressReporter progress(reader->progress_callback, reader->progress_context);
+  return ZipExtractArchive(reader->uf, target_dir, 0, &stats, &progress);
+}
+
+#ifdef _WIN32
+ZLIBWRAP_API bool ZipReaderUpdate(ZipReaderHandle reader,
+                                  const TCHAR *target_dir,
+                                  bool compare_crc,
+                                  unsigned long long *skipped_entries,
+                                  unsigned long long *skipped_bytes) {
+#else
+ZLIBWRAP_API bool ZipReaderUpdate(ZipReaderHandle reader,
+                                  const char *target_dir,
+                                  bool compare_crc,
+                                  unsigned long long *skipped_entries,
+                                  unsigned long long *skipped_bytes) {
+#endif
+  if (reader == NULL || target_dir == NULL)
+    return false;
+  unsigned int flags = zlibwrap::ZIP_EXTRACT_SKIP_UNCHANGED | (compare_crc ? zlibwrap::ZIP_EXTRACT_COMPARE_CRC : 0);
+  zlibwrap::ZipExtractStats stats = {};
+  ZipProgressReporter progress(reader->progress_callback, reader->progress_context);
+  bool result = ZipExtractArchive(reader->uf, target_dir, flags, &stats, &progress);
+  if (skipped_entries != NULL)
+    *skipped_entries = stats.skipped_entries;
+  if (skipped_bytes != NULL)
+    *skipped_bytes = stats.skipped_bytes;
+  return result;
+}
+
+ZLIBWRAP_API bool ZipReaderTest(ZipReaderHandle reader) {
+  if (reader == NULL)
+    return false;
+  ZipProgressReporter progress(reader->progress_callback, reader->progress_context);
+  return ZipTestArchive(reader->opened_file, &reader->filefunc, NULL, reader->thread_count, &progress);
+}
+
+ZLIBWRAP_API void ZipReaderClose(ZipReaderHandle reader) {
+  if (reader == NULL)
+    return;
+  unzClose(reader->uf);
+  delete reader;
+}